@@ -0,0 +1,143 @@
+#include "pch.h"
+#include "ClientStats.h"
+
+namespace WebS {
+
+static size_t valueBytes(const Value& value) {
+    switch (value.type()) {
+        case ValueType::string:
+            return value.as_string().size();
+        case ValueType::float64:
+            return sizeof(double);
+        case ValueType::boolean:
+            return 1;
+        case ValueType::binary:
+            return value.as_binary().size();
+        case ValueType::array: {
+            size_t total = 0;
+            for (const auto& item : value.as_array()) total += valueBytes(item);
+            return total;
+        }
+        case ValueType::map: {
+            size_t total = 0;
+            for (const auto& entry : value.as_map()) total += entry.first.size() + valueBytes(entry.second);
+            return total;
+        }
+        default:
+            return 0;
+    }
+}
+
+size_t ClientStats::payloadBytes(const std::vector<Value>& args) {
+    size_t total = 0;
+    for (const auto& arg : args) total += valueBytes(arg);
+    return total;
+}
+
+MethodCounters& ClientStats::method(const std::string& name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(methodsMutex_);
+        auto it = methods_.find(name);
+        if (it != methods_.end()) return *it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(methodsMutex_);
+    auto& slot = methods_[name];
+    if (!slot) slot = std::make_unique<MethodCounters>();
+    return *slot;
+}
+
+MethodLatency& ClientStats::latency(const std::string& name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(latenciesMutex_);
+        auto it = latencies_.find(name);
+        if (it != latencies_.end()) return *it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(latenciesMutex_);
+    auto& slot = latencies_[name];
+    if (!slot) slot = std::make_unique<MethodLatency>();
+    return *slot;
+}
+
+std::map<std::string, const MethodLatency*> ClientStats::latencies() const {
+    std::shared_lock<std::shared_mutex> lock(latenciesMutex_);
+    std::map<std::string, const MethodLatency*> result;
+    for (const auto& entry : latencies_) {
+        result[entry.first] = entry.second.get();
+    }
+    return result;
+}
+
+void ClientStats::resetLatency() {
+    std::shared_lock<std::shared_mutex> lock(latenciesMutex_);
+    for (const auto& entry : latencies_) {
+        entry.second->reset();
+    }
+}
+
+void ClientStats::recordConnect(double durationMs, bool reconnect) {
+    uint64_t us = static_cast<uint64_t>(durationMs * 1000.0);
+    add(connects_);
+    if (reconnect) add(reconnects_);
+    add(totalConnectUs_, us);
+    lastConnectUs_.store(us, std::memory_order_relaxed);
+
+    uint64_t previous = maxConnectUs_.load(std::memory_order_relaxed);
+    while (us > previous && !maxConnectUs_.compare_exchange_weak(previous, us, std::memory_order_relaxed)) {
+    }
+}
+
+void ClientStats::snapshot(StatsSnapshot& out) const {
+    {
+        std::shared_lock<std::shared_mutex> lock(methodsMutex_);
+        for (const auto& entry : methods_) {
+            StatsSnapshot::Method& method = out.methods[entry.first];
+            method.messagesIn = entry.second->messagesIn.load(std::memory_order_relaxed);
+            method.bytesIn = entry.second->bytesIn.load(std::memory_order_relaxed);
+            method.messagesOut = entry.second->messagesOut.load(std::memory_order_relaxed);
+            method.bytesOut = entry.second->bytesOut.load(std::memory_order_relaxed);
+        }
+    }
+
+    out.droppedMessages = droppedMessages.load(std::memory_order_relaxed);
+    out.droppedResults = droppedResults.load(std::memory_order_relaxed);
+    out.sendFailures = sendFailures.load(std::memory_order_relaxed);
+    out.reconnectAttempts = reconnectAttempts.load(std::memory_order_relaxed);
+    out.invocationsInFlight = invocationsInFlight.load(std::memory_order_relaxed);
+    out.callbackErrors += detachedCallbackErrors.load(std::memory_order_relaxed);
+
+    out.connects = connects_.load(std::memory_order_relaxed);
+    out.reconnects = reconnects_.load(std::memory_order_relaxed);
+    out.lastConnectMs = lastConnectUs_.load(std::memory_order_relaxed) / 1000.0;
+    out.maxConnectMs = maxConnectUs_.load(std::memory_order_relaxed) / 1000.0;
+    if (out.connects > 0) {
+        out.avgConnectMs = totalConnectUs_.load(std::memory_order_relaxed) / 1000.0 / static_cast<double>(out.connects);
+    }
+}
+
+void ClientStats::reset() {
+    {
+        std::shared_lock<std::shared_mutex> lock(methodsMutex_);
+        for (const auto& entry : methods_) {
+            entry.second->messagesIn.store(0, std::memory_order_relaxed);
+            entry.second->bytesIn.store(0, std::memory_order_relaxed);
+            entry.second->messagesOut.store(0, std::memory_order_relaxed);
+            entry.second->bytesOut.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // invocationsInFlight is a gauge, not a counter, and is left alone
+    droppedMessages.store(0, std::memory_order_relaxed);
+    droppedResults.store(0, std::memory_order_relaxed);
+    sendFailures.store(0, std::memory_order_relaxed);
+    reconnectAttempts.store(0, std::memory_order_relaxed);
+    detachedCallbackErrors.store(0, std::memory_order_relaxed);
+    connects_.store(0, std::memory_order_relaxed);
+    reconnects_.store(0, std::memory_order_relaxed);
+    totalConnectUs_.store(0, std::memory_order_relaxed);
+    lastConnectUs_.store(0, std::memory_order_relaxed);
+    maxConnectUs_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace WebS
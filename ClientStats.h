@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <shared_mutex>
+#include "Types.h"
+#include "LatencyHistogram.h"
+#include "Value.h"
+
+namespace WebS {
+
+// Per hub method traffic; updated with relaxed atomics from the SignalR and game threads
+struct MethodCounters {
+    std::atomic<uint64_t> messagesIn{0};
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> messagesOut{0};
+    std::atomic<uint64_t> bytesOut{0};
+};
+
+struct StatsSnapshot {
+    struct Method {
+        uint64_t messagesIn = 0;
+        uint64_t bytesIn = 0;
+        uint64_t messagesOut = 0;
+        uint64_t bytesOut = 0;
+    };
+
+    std::map<std::string, Method> methods;
+    std::map<std::string, QueueDepth> queues;   // Summed over all Lua contexts, peak = max
+    uint64_t droppedMessages = 0;
+    uint64_t droppedResults = 0;
+    uint64_t sendFailures = 0;
+    uint64_t connects = 0;
+    uint64_t reconnects = 0;
+    uint64_t reconnectAttempts = 0;
+    double lastConnectMs = 0;
+    double avgConnectMs = 0;
+    double maxConnectMs = 0;
+    int64_t invocationsInFlight = 0;
+    uint64_t callbackErrors = 0;
+};
+
+// Counters behind WebS.GetStats(). Inbound handlers resolve their MethodCounters once when
+// they are bound and then only touch atomics. Sends look theirs (and SendMessageAsync its
+// MethodLatency) up per call: a shared lock and a map lookup each, see BM_ClientStats_SendLookup.
+// The maps are only locked exclusively to add methods.
+class ClientStats {
+public:
+    // The reference stays valid for the lifetime of the client
+    MethodCounters& method(const std::string& name);
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t value = 1) {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Allocated on first use; the reference stays valid for the lifetime of the client
+    MethodLatency& latency(const std::string& name);
+    std::map<std::string, const MethodLatency*> latencies() const;
+    void resetLatency();
+
+    // Approximate wire size of the arguments (strings, numbers, binary; JSON framing excluded)
+    static size_t payloadBytes(const std::vector<Value>& args);
+
+    void recordConnect(double durationMs, bool reconnect);
+
+    // Fills the counters; queue depths and callback errors are added by the client
+    void snapshot(StatsSnapshot& out) const;
+    void reset();
+
+    std::atomic<uint64_t> droppedMessages{0};    // Server messages no script accepted
+    std::atomic<uint64_t> droppedResults{0};     // Invocation results for unloaded scripts
+    std::atomic<uint64_t> sendFailures{0};
+    std::atomic<uint64_t> reconnectAttempts{0};
+    std::atomic<int64_t> invocationsInFlight{0};
+    std::atomic<uint64_t> detachedCallbackErrors{0}; // From contexts that have been released
+
+private:
+    std::map<std::string, std::unique_ptr<MethodCounters>> methods_;
+    mutable std::shared_mutex methodsMutex_;
+
+    std::map<std::string, std::unique_ptr<MethodLatency>> latencies_;
+    mutable std::shared_mutex latenciesMutex_;
+
+    std::atomic<uint64_t> connects_{0};
+    std::atomic<uint64_t> reconnects_{0};
+    std::atomic<uint64_t> totalConnectUs_{0};
+    std::atomic<uint64_t> lastConnectUs_{0};
+    std::atomic<uint64_t> maxConnectUs_{0};
+};
+
+} // namespace WebS
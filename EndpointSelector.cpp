@@ -0,0 +1,192 @@
+#include "pch.h"
+#include "EndpointSelector.h"
+#include "Logger.h"
+
+namespace WebS {
+
+namespace {
+
+struct EndpointHealth {
+    double rttMs = -1.0;                    // Smoothed; < 0 = never measured
+    std::chrono::steady_clock::time_point lastProbe;
+    std::chrono::steady_clock::time_point lastFailure;
+    int consecutiveFailures = 0;
+    uint64_t failures = 0;
+    uint64_t successes = 0;
+};
+
+std::mutex healthMutex;
+std::map<std::string, EndpointHealth> healthCache;
+
+const double RttSmoothing = 0.3;
+const double UnmeasuredScore = 1e9;
+
+void recordRtt(EndpointHealth& health, double rttMs) {
+    health.rttMs = health.rttMs < 0 ? rttMs : health.rttMs + RttSmoothing * (rttMs - health.rttMs);
+    health.lastProbe = std::chrono::steady_clock::now();
+}
+
+void recordFailure(EndpointHealth& health) {
+    health.consecutiveFailures++;
+    health.failures++;
+    health.lastFailure = std::chrono::steady_clock::now();
+}
+
+double score(const EndpointHealth& health, std::chrono::steady_clock::time_point now) {
+    double value = health.rttMs < 0 ? UnmeasuredScore : health.rttMs;
+    if (health.consecutiveFailures > 0 &&
+        now - health.lastFailure < std::chrono::milliseconds(EndpointSelector::FailureWindowMs)) {
+        value += static_cast<double>(health.consecutiveFailures) * EndpointSelector::FailurePenaltyMs;
+    }
+    return value;
+}
+
+// "https://host/hub?x=1" -> "https://host/hub/negotiate?negotiateVersion=1&x=1"
+std::string negotiateUrl(const std::string& url) {
+    size_t queryPos = url.find('?');
+    std::string base = url.substr(0, queryPos);
+    while (!base.empty() && base.back() == '/') base.pop_back();
+
+    std::string result = base + "/negotiate?negotiateVersion=1";
+    if (queryPos != std::string::npos) {
+        result += "&" + url.substr(queryPos + 1);
+    }
+    return result;
+}
+
+} // namespace
+
+void EndpointSelector::setEndpoints(const std::vector<std::string>& urls) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    urls_ = urls;
+    active_.clear();
+}
+
+size_t EndpointSelector::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return urls_.size();
+}
+
+void EndpointSelector::probe(Transport& transport, const ConnectOptions& options) {
+    std::vector<std::string> stale;
+    uint64_t cancellations;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (urls_.size() < 2) return;
+        cancellations = cancellations_;
+
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> healthLock(healthMutex);
+        for (const auto& url : urls_) {
+            const EndpointHealth& health = healthCache[url];
+            if (health.rttMs < 0 || now - health.lastProbe > std::chrono::milliseconds(CacheTtlMs)) {
+                stale.push_back(url);
+            }
+        }
+    }
+    if (stale.empty()) {
+        Logger::instance().verbose("Endpoint RTTs cached, skipping probe");
+        return;
+    }
+
+    Logger::instance().debug("Probing " + std::to_string(stale.size()) + " endpoint(s)...");
+
+    std::vector<std::string> requests;
+    for (const auto& url : stale) {
+        requests.push_back(negotiateUrl(url));
+    }
+    std::shared_ptr<EndpointProbe> probing = transport.probe(requests, options, ProbeTimeoutMs);
+    {
+        // A cancelProbes() while the requests were being started found no probing_ to cancel
+        std::lock_guard<std::mutex> lock(mutex_);
+        probing_ = probing;
+        if (cancellations_ != cancellations) probing->cancel();
+    }
+
+    // Any HTTP answer, even 401, proves the endpoint is reachable and gives an RTT
+    std::vector<ProbeResult> results = probing->wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (probing_ == probing) probing_ = nullptr;
+    }
+
+    for (size_t i = 0; i < stale.size() && i < results.size(); ++i) {
+        const std::string& url = stale[i];
+        const ProbeResult& result = results[i];
+        if (!result.error.empty()) {
+            if (probing->cancelled()) continue;
+            Logger::instance().warning("Endpoint probe failed for " + url + ": " + result.error);
+            std::lock_guard<std::mutex> healthLock(healthMutex);
+            recordFailure(healthCache[url]);
+        } else if (result.status != 0) {
+            Logger::instance().verbose("Endpoint " + url + ": " + std::to_string(static_cast<int>(result.rttMs)) +
+                "ms (HTTP " + std::to_string(result.status) + ")");
+            std::lock_guard<std::mutex> healthLock(healthMutex);
+            recordRtt(healthCache[url], result.rttMs);
+        }
+    }
+}
+
+void EndpointSelector::cancelProbes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++cancellations_;
+    if (probing_) probing_->cancel();
+}
+
+std::string EndpointSelector::select(const std::string& exclude) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (urls_.empty()) return "";
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> healthLock(healthMutex);
+
+    const std::string* best = nullptr;
+    double bestScore = 0;
+    for (const auto& url : urls_) {
+        if (url == exclude) continue;
+        double value = score(healthCache[url], now);
+        if (!best || value < bestScore) {
+            best = &url;
+            bestScore = value;
+        }
+    }
+    return best ? *best : "";
+}
+
+void EndpointSelector::reportSuccess(const std::string& url) {
+    std::lock_guard<std::mutex> healthLock(healthMutex);
+    EndpointHealth& health = healthCache[url];
+    health.consecutiveFailures = 0;
+    health.successes++;
+}
+
+void EndpointSelector::reportFailure(const std::string& url) {
+    std::lock_guard<std::mutex> healthLock(healthMutex);
+    recordFailure(healthCache[url]);
+}
+
+void EndpointSelector::setActive(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_ = url;
+}
+
+std::vector<EndpointStats> EndpointSelector::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> healthLock(healthMutex);
+
+    std::vector<EndpointStats> result;
+    for (const auto& url : urls_) {
+        const EndpointHealth& health = healthCache[url];
+        EndpointStats entry;
+        entry.url = url;
+        entry.rttMs = health.rttMs;
+        entry.consecutiveFailures = health.consecutiveFailures;
+        entry.failures = health.failures;
+        entry.successes = health.successes;
+        entry.active = url == active_;
+        result.push_back(entry);
+    }
+    return result;
+}
+
+} // namespace WebS
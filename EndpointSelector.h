@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include "Types.h"
+#include "Transport.h"
+
+namespace WebS {
+
+// Picks the endpoint to connect to from a client's url list. Health (RTT and recent
+// failures) is cached process-wide per URL, so later connects and other clients reuse
+// measurements instead of probing again.
+class EndpointSelector {
+public:
+    static constexpr int ProbeTimeoutMs = 2000;
+    static constexpr int CacheTtlMs = 5 * 60 * 1000;
+    static constexpr int FailurePenaltyMs = 1000;     // Added to the RTT per consecutive failure
+    static constexpr int FailureWindowMs = 60 * 1000; // Failures older than this are forgiven
+
+    void setEndpoints(const std::vector<std::string>& urls);
+    size_t size() const;
+
+    // Sends a negotiate request to every endpoint without a fresh RTT; all probes run in parallel
+    void probe(Transport& transport, const ConnectOptions& options);
+    // Aborts an in-flight probe at once; the endpoints are left unmeasured, not penalized
+    void cancelProbes();
+
+    // Lowest RTT plus failure penalty wins; ties keep list order
+    std::string select(const std::string& exclude = "") const;
+
+    void reportSuccess(const std::string& url);
+    void reportFailure(const std::string& url);
+    void setActive(const std::string& url);
+
+    std::vector<EndpointStats> stats() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::string> urls_;
+    std::string active_;
+    std::shared_ptr<EndpointProbe> probing_;
+    uint64_t cancellations_ = 0;   // Bumped by cancelProbes, so a probe still starting sees it
+};
+
+} // namespace WebS
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "EventManager.h"
+#include "WebSClient.h"
 #include "Logger.h"
+#include "Tracer.h"
 
 extern "C" {
 #include "lauxlib.h"
@@ -25,11 +27,48 @@ namespace WebS {
         return ref;
     }
 
+    int EventManager::onBatch(lua_State* L, const std::string& eventName, int callbackStackIndex) {
+        if (!L) return -1;
+
+        if (!lua_isfunction(L, callbackStackIndex)) {
+            Logger::instance().luaError("EventManager::onBatch", "Argument is not a function");
+            return -1;
+        }
+
+        lua_pushvalue(L, callbackStackIndex);
+        int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+        lua_newtable(L);
+        int tableRef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+        std::lock_guard<std::mutex> lock(callbacksMutex_);
+        batchCallbacks_[eventName].push_back({ ref, tableRef, 0 });
+
+        return ref;
+    }
+
     void EventManager::off(lua_State* L, const std::string& eventName, int callbackRef) {
         if (!L) return;
 
         std::lock_guard<std::mutex> lock(callbacksMutex_);
 
+        auto batchIt = batchCallbacks_.find(eventName);
+        if (batchIt != batchCallbacks_.end()) {
+            auto& batchVec = batchIt->second;
+            for (auto vecIt = batchVec.begin(); vecIt != batchVec.end(); ++vecIt) {
+                if (vecIt->ref == callbackRef) {
+                    luaL_unref(L, LUA_REGISTRYINDEX, vecIt->ref);
+                    profiler_.forgetRef(vecIt->ref);
+                    luaL_unref(L, LUA_REGISTRYINDEX, vecIt->tableRef);
+                    batchVec.erase(vecIt);
+                    break;
+                }
+            }
+            if (batchVec.empty()) {
+                batchCallbacks_.erase(batchIt);
+            }
+        }
+
         auto it = callbacks_.find(eventName);
         if (it == callbacks_.end()) return;
 
@@ -37,6 +76,7 @@ namespace WebS {
         for (auto vecIt = vec.begin(); vecIt != vec.end(); ++vecIt) {
             if (vecIt->ref == callbackRef) {
                 luaL_unref(L, LUA_REGISTRYINDEX, callbackRef);
+                profiler_.forgetRef(callbackRef);
                 vec.erase(vecIt);
                 break;
             }
@@ -53,16 +93,27 @@ namespace WebS {
         std::lock_guard<std::mutex> lock(callbacksMutex_);
 
         auto it = callbacks_.find(eventName);
-        if (it == callbacks_.end()) return;
+        if (it != callbacks_.end()) {
+            for (auto& cb : it->second) {
+                luaL_unref(L, LUA_REGISTRYINDEX, cb.ref);
+                profiler_.forgetRef(cb.ref);
+            }
+            callbacks_.erase(it);
+        }
 
-        for (auto& cb : it->second) {
-            luaL_unref(L, LUA_REGISTRYINDEX, cb.ref);
+        auto batchIt = batchCallbacks_.find(eventName);
+        if (batchIt != batchCallbacks_.end()) {
+            for (auto& cb : batchIt->second) {
+                luaL_unref(L, LUA_REGISTRYINDEX, cb.ref);
+                profiler_.forgetRef(cb.ref);
+                luaL_unref(L, LUA_REGISTRYINDEX, cb.tableRef);
+            }
+            batchCallbacks_.erase(batchIt);
         }
-        callbacks_.erase(it);
     }
 
-    void EventManager::emit(const std::string& eventName, const std::vector<std::string>& args) {
-        eventQueue_.push({ eventName, args });
+    void EventManager::emit(const std::string& eventName, const std::vector<std::string>& args, const std::vector<int>& targets) {
+        eventQueue_.push({ eventName, args, targets });
     }
 
     int EventManager::processEvents(lua_State* L) {
@@ -82,7 +133,7 @@ namespace WebS {
 
             lua_settop(L, top);
 
-            callCallbacks(L, event.name, event.args);
+            callCallbacks(L, event.name, event.args, event.targets);
 
             lua_settop(L, top);
 
@@ -100,9 +151,18 @@ namespace WebS {
         for (auto& pair : callbacks_) {
             for (auto& cb : pair.second) {
                 luaL_unref(L, LUA_REGISTRYINDEX, cb.ref);
+                profiler_.forgetRef(cb.ref);
             }
         }
         callbacks_.clear();
+        for (auto& pair : batchCallbacks_) {
+            for (auto& cb : pair.second) {
+                luaL_unref(L, LUA_REGISTRYINDEX, cb.ref);
+                profiler_.forgetRef(cb.ref);
+                luaL_unref(L, LUA_REGISTRYINDEX, cb.tableRef);
+            }
+        }
+        batchCallbacks_.clear();
         std::queue<LuaEvent> empty;
         eventQueue_.swap(empty);
     }
@@ -114,6 +174,26 @@ namespace WebS {
         return it->second.size();
     }
 
+    size_t EventManager::batchCallbackCount(const std::string& eventName) const {
+        std::lock_guard<std::mutex> lock(callbacksMutex_);
+        auto it = batchCallbacks_.find(eventName);
+        if (it == batchCallbacks_.end()) return 0;
+        return it->second.size();
+    }
+
+    bool EventManager::findBatchCallback(const std::string& eventName, int ref, BatchCallbackInfo& out) const {
+        std::lock_guard<std::mutex> lock(callbacksMutex_);
+        auto it = batchCallbacks_.find(eventName);
+        if (it == batchCallbacks_.end()) return false;
+        for (const auto& cb : it->second) {
+            if (cb.ref == ref) {
+                out = cb;
+                return true;
+            }
+        }
+        return false;
+    }
+
     bool EventManager::isRefValid(const std::string& eventName, int ref) const {
         std::lock_guard<std::mutex> lock(callbacksMutex_);
         auto it = callbacks_.find(eventName);
@@ -124,7 +204,7 @@ namespace WebS {
         return false;
     }
 
-    void EventManager::callCallbacks(lua_State* L, const std::string& eventName, const std::vector<std::string>& args) {
+    void EventManager::callCallbacks(lua_State* L, const std::string& eventName, const std::vector<std::string>& args, const std::vector<int>& targets) {
         if (!L) return;
 
         std::vector<int> refs;
@@ -133,6 +213,9 @@ namespace WebS {
             auto it = callbacks_.find(eventName);
             if (it == callbacks_.end()) return;
             for (const auto& cb : it->second) {
+                if (!targets.empty() && std::find(targets.begin(), targets.end(), cb.ref) == targets.end()) {
+                    continue;
+                }
                 refs.push_back(cb.ref);
             }
         }
@@ -157,16 +240,149 @@ namespace WebS {
                 lua_pushstring(L, arg.c_str());
             }
 
-            if (lua_pcall(L, static_cast<int>(args.size()), 0, 0) != 0) {
+            if (call(L, eventName, static_cast<int>(args.size()), ref) != 0) {
                 const char* err = lua_tostring(L, -1);
                 Logger::instance().luaError(eventName, err ? err : "unknown error");
+                callbackErrors_.fetch_add(1, std::memory_order_relaxed);
                 lua_pop(L, 1);
             }
         }
     }
 
+    int EventManager::dispatchBatch(lua_State* L, const std::string& eventName, const std::vector<ServerMessage>& messages) {
+        if (!L || messages.empty()) return 0;
+
+        std::vector<int> refs;
+        {
+            std::lock_guard<std::mutex> lock(callbacksMutex_);
+            auto it = batchCallbacks_.find(eventName);
+            if (it == batchCallbacks_.end()) return 0;
+            for (const auto& cb : it->second) {
+                refs.push_back(cb.ref);
+            }
+        }
+
+        int dispatched = 0;
+        for (int ref : refs) {
+            // An earlier handler may have called Off(): its refs are freed and can already hold
+            // something else, so only a handler still registered is called, with its current table
+            BatchCallbackInfo info;
+            if (!findBatchCallback(eventName, ref, info)) {
+                continue;
+            }
+
+            if (!lua_checkstack(L, 8)) {
+                Logger::instance().luaError(eventName, "Stack overflow risk in batch callback");
+                continue;
+            }
+
+            int top = lua_gettop(L);
+
+            lua_rawgeti(L, LUA_REGISTRYINDEX, info.ref);
+            if (!lua_isfunction(L, -1)) {
+                lua_settop(L, top);
+                continue;
+            }
+
+            lua_rawgeti(L, LUA_REGISTRYINDEX, info.tableRef);
+            int batchIndex = lua_gettop(L);
+
+            int count = 0;
+            for (const auto& msg : messages) {
+                if (!msg.targets.empty() && std::find(msg.targets.begin(), msg.targets.end(), info.ref) == msg.targets.end()) {
+                    continue;
+                }
+                ++count;
+
+                // Reuse the per-invocation args table from the previous frame when there is one
+                lua_rawgeti(L, batchIndex, count);
+                if (!lua_istable(L, -1)) {
+                    lua_pop(L, 1);
+                    lua_createtable(L, static_cast<int>(msg.args.size()), 0);
+                    lua_pushvalue(L, -1);
+                    lua_rawseti(L, batchIndex, count);
+                }
+
+                int previousLen = static_cast<int>(lua_objlen(L, -1));
+                int argCount = static_cast<int>(msg.args.size());
+                for (int i = 0; i < argCount; ++i) {
+                    pushValueToLua(L, msg.args[i]);
+                    lua_rawseti(L, -2, i + 1);
+                }
+                for (int i = argCount + 1; i <= previousLen; ++i) {
+                    lua_pushnil(L);
+                    lua_rawseti(L, -2, i);
+                }
+                lua_pop(L, 1);
+            }
+
+            if (count == 0) {
+                lua_settop(L, top);
+                continue;
+            }
+
+            int previousSize = info.lastSize;
+            for (int i = count + 1; i <= previousSize; ++i) {
+                lua_pushnil(L);
+                lua_rawseti(L, batchIndex, i);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(callbacksMutex_);
+                auto it = batchCallbacks_.find(eventName);
+                if (it != batchCallbacks_.end()) {
+                    for (auto& cb : it->second) {
+                        if (cb.ref == info.ref) {
+                            cb.lastSize = count;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            lua_pushinteger(L, count);
+            if (call(L, eventName, 2, info.ref) != 0) {
+                const char* err = lua_tostring(L, -1);
+                Logger::instance().luaError(eventName, err ? err : "unknown error");
+                callbackErrors_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            lua_settop(L, top);
+            dispatched += count;
+        }
+
+        return dispatched;
+    }
+
+    int EventManager::call(lua_State* L, const std::string& eventName, int nargs, int ref) {
+        TraceSpan span("lua.pcall", "lua", eventName);
+        if (!profiler_.enabled()) {
+            return lua_pcall(L, nargs, 0, 0);
+        }
+
+        std::string source = profiler_.sourceOf(L, -(nargs + 1), ref);
+        auto start = std::chrono::steady_clock::now();
+        int status = lua_pcall(L, nargs, 0, 0);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        // A slow OnSlowHandler callback must not report itself every frame
+        if (profiler_.record(eventName, source, elapsed) && eventName != "OnSlowHandler") {
+            double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+            emit("OnSlowHandler", { eventName, source, std::to_string(ms) });
+        }
+        return status;
+    }
+
+    HandlerProfiler& EventManager::profiler() {
+        return profiler_;
+    }
+
+    void EventManager::setLegacyCallbacks(bool enabled) {
+        legacyCallbacks_.store(enabled);
+    }
+
     void EventManager::callLegacyCallback(lua_State* L, const std::string& eventName, const std::vector<std::string>& args) {
-        if (!L) return;
+        if (!L || !legacyCallbacks_.load()) return;
 
         int top = lua_gettop(L);
 
@@ -191,12 +407,26 @@ namespace WebS {
             lua_pushstring(L, arg.c_str());
         }
 
-        if (lua_pcall(L, static_cast<int>(args.size()), 0, 0) != 0) {
+        if (call(L, eventName, static_cast<int>(args.size())) != 0) {
             const char* err = lua_tostring(L, -1);
             Logger::instance().luaError(eventName, err ? err : "unknown error");
+            callbackErrors_.fetch_add(1, std::memory_order_relaxed);
         }
 
         lua_settop(L, top);
     }
 
+    uint64_t EventManager::callbackErrors() const {
+        return callbackErrors_.load(std::memory_order_relaxed);
+    }
+
+    QueueDepth EventManager::queueDepth() const {
+        return { eventQueue_.size(), eventQueue_.peak() };
+    }
+
+    void EventManager::resetStats() {
+        callbackErrors_.store(0, std::memory_order_relaxed);
+        eventQueue_.resetPeak();
+    }
+
 } // namespace WebS
\ No newline at end of file
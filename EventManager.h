@@ -4,8 +4,10 @@
 #include <vector>
 #include <map>
 #include <mutex>
+#include <atomic>
 #include "Types.h"
 #include "ThreadSafeQueue.h"
+#include "HandlerProfiler.h"
 
 extern "C" {
 #include "lua.h"
@@ -16,25 +18,53 @@ namespace WebS {
 class EventManager {
 public:
     int on(lua_State* L, const std::string& eventName, int callbackStackIndex);
+    int onBatch(lua_State* L, const std::string& eventName, int callbackStackIndex);
     void off(lua_State* L, const std::string& eventName, int callbackRef);
     void offAll(lua_State* L, const std::string& eventName);
-    void emit(const std::string& eventName, const std::vector<std::string>& args = {});
+    void emit(const std::string& eventName, const std::vector<std::string>& args = {}, const std::vector<int>& targets = {});
     int processEvents(lua_State* L);
+    int dispatchBatch(lua_State* L, const std::string& eventName, const std::vector<ServerMessage>& messages);
     void clear(lua_State* L);
     size_t callbackCount(const std::string& eventName) const;
+    size_t batchCallbackCount(const std::string& eventName) const;
     bool isRefValid(const std::string& eventName, int ref) const;
 
+    // Legacy WebS.<EventName> globals only apply to the default client
+    void setLegacyCallbacks(bool enabled);
+
+    // lua_pcall of the function below nargs arguments, timed when profiling is enabled
+    int call(lua_State* L, const std::string& eventName, int nargs, int ref = LUA_NOREF);
+    HandlerProfiler& profiler();
+
+    uint64_t callbackErrors() const;
+    QueueDepth queueDepth() const;
+    void resetStats();
+
 private:
     struct CallbackInfo {
         int ref;
     };
 
-    void callCallbacks(lua_State* L, const std::string& eventName, const std::vector<std::string>& args);
+    // The batch array is kept in the registry and reused across frames; one per handler
+    struct BatchCallbackInfo {
+        int ref;
+        int tableRef;
+        int lastSize;
+    };
+
+    // Copies the handler's current entry; false once it has been removed
+    bool findBatchCallback(const std::string& eventName, int ref, BatchCallbackInfo& out) const;
+
+    void callCallbacks(lua_State* L, const std::string& eventName, const std::vector<std::string>& args, const std::vector<int>& targets);
     void callLegacyCallback(lua_State* L, const std::string& eventName, const std::vector<std::string>& args);
 
     std::map<std::string, std::vector<CallbackInfo>> callbacks_;
+    std::map<std::string, std::vector<BatchCallbackInfo>> batchCallbacks_;
     ThreadSafeQueue<LuaEvent> eventQueue_;
     mutable std::mutex callbacksMutex_;
+    std::atomic<bool> legacyCallbacks_{ true };
+    std::atomic<uint64_t> callbackErrors_{ 0 };
+    HandlerProfiler profiler_;
 };
 
 } // namespace WebS
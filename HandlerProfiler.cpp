@@ -0,0 +1,97 @@
+#include "pch.h"
+#include "HandlerProfiler.h"
+
+namespace WebS {
+
+void HandlerProfiler::setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void HandlerProfiler::setSlowThresholdMs(double thresholdMs) {
+    slowThresholdMs_.store(thresholdMs, std::memory_order_relaxed);
+}
+
+double HandlerProfiler::slowThresholdMs() const {
+    return slowThresholdMs_.load(std::memory_order_relaxed);
+}
+
+std::string HandlerProfiler::sourceOf(lua_State* L, int funcIndex, int ref) {
+    if (ref != LUA_NOREF && ref != LUA_REFNIL) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sourceCache_.find(ref);
+        if (it != sourceCache_.end()) return it->second;
+    }
+
+    lua_Debug ar;
+    lua_pushvalue(L, funcIndex);
+    std::string source = "?";
+    if (lua_getinfo(L, ">S", &ar)) {
+        source = std::string(ar.short_src) + ":" + std::to_string(ar.linedefined);
+    }
+
+    if (ref != LUA_NOREF && ref != LUA_REFNIL) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sourceCache_[ref] = source;
+    }
+    return source;
+}
+
+void HandlerProfiler::forgetRef(int ref) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sourceCache_.erase(ref);
+}
+
+bool HandlerProfiler::record(const std::string& event, const std::string& source, std::chrono::steady_clock::duration elapsed) {
+    double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+    bool slow = ms >= slowThresholdMs();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = entries_[event + "|" + source];
+    if (!entry) {
+        entry = std::make_unique<Entry>();
+        entry->event = event;
+        entry->source = source;
+    }
+    entry->calls++;
+    entry->totalMs += ms;
+    if (slow) entry->slowCalls++;
+    entry->histogram.record(elapsed);
+    return slow;
+}
+
+std::vector<HandlerProfileEntry> HandlerProfiler::top(size_t limit) const {
+    std::vector<HandlerProfileEntry> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result.reserve(entries_.size());
+        for (const auto& item : entries_) {
+            const Entry& entry = *item.second;
+            HandlerProfileEntry out;
+            out.event = entry.event;
+            out.source = entry.source;
+            out.calls = entry.calls;
+            out.slowCalls = entry.slowCalls;
+            out.totalMs = entry.totalMs;
+            out.p50Ms = entry.histogram.percentileMicros(50) / 1000.0;
+            out.p90Ms = entry.histogram.percentileMicros(90) / 1000.0;
+            out.p99Ms = entry.histogram.percentileMicros(99) / 1000.0;
+            out.maxMs = entry.histogram.maxMicros() / 1000.0;
+            result.push_back(std::move(out));
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const HandlerProfileEntry& a, const HandlerProfileEntry& b) {
+        return a.totalMs > b.totalMs;
+    });
+    if (result.size() > limit) {
+        result.resize(limit);
+    }
+    return result;
+}
+
+void HandlerProfiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+} // namespace WebS
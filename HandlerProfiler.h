@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "LatencyHistogram.h"
+
+extern "C" {
+#include "lua.h"
+#include "lauxlib.h"
+}
+
+namespace WebS {
+
+struct HandlerProfileEntry {
+    std::string event;
+    std::string source;            // "script.lua:42" of the function definition
+    uint64_t calls = 0;
+    uint64_t slowCalls = 0;
+    double totalMs = 0;
+    double p50Ms = 0;
+    double p90Ms = 0;
+    double p99Ms = 0;
+    double maxMs = 0;
+};
+
+// Times Lua callbacks of one script, keyed by event name and the callback's source
+// location. Off by default; when disabled the only cost is one atomic load per call.
+class HandlerProfiler {
+public:
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+    void setSlowThresholdMs(double thresholdMs);
+    double slowThresholdMs() const;
+
+    // Source of the function at funcIndex; cached per registry ref when ref is valid
+    std::string sourceOf(lua_State* L, int funcIndex, int ref = LUA_NOREF);
+    void forgetRef(int ref);
+
+    // Returns true when the call crossed the slow threshold
+    bool record(const std::string& event, const std::string& source, std::chrono::steady_clock::duration elapsed);
+
+    // Sorted by total time, worst first
+    std::vector<HandlerProfileEntry> top(size_t limit) const;
+    void reset();
+
+private:
+    struct Entry {
+        std::string event;
+        std::string source;
+        uint64_t calls = 0;
+        uint64_t slowCalls = 0;
+        double totalMs = 0;
+        LatencyHistogram histogram;
+    };
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<double> slowThresholdMs_{16.0};
+
+    std::map<std::string, std::unique_ptr<Entry>> entries_;
+    std::map<int, std::string> sourceCache_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace WebS
@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "LatencyHistogram.h"
+
+namespace WebS {
+
+int LatencyHistogram::bucketIndex(uint64_t micros) {
+    if (micros < SubBuckets) {
+        return static_cast<int>(micros);
+    }
+
+    int magnitude = 0;
+    for (uint64_t v = micros >> SubBucketBits; v != 0; v >>= 1) {
+        magnitude++;
+    }
+    if (magnitude >= Magnitudes) {
+        return BucketCount - 1;
+    }
+
+    // Top SubBucketBits bits below the leading one select the linear sub-bucket
+    int subBucket = static_cast<int>((micros >> (magnitude - 1)) & (SubBuckets - 1));
+    return magnitude * SubBuckets + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+    if (index == BucketCount - 1) {
+        return UINT64_MAX;   // Overflow bucket; callers clamp to the recorded max
+    }
+    int magnitude = index / SubBuckets;
+    uint64_t subBucket = static_cast<uint64_t>(index % SubBuckets);
+    if (magnitude == 0) {
+        return subBucket;
+    }
+    uint64_t width = 1ull << (magnitude - 1);
+    return ((SubBuckets + subBucket) << (magnitude - 1)) + width - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    buckets_[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t previous = max_.load(std::memory_order_relaxed);
+    while (micros > previous && !max_.compare_exchange_weak(previous, micros, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration elapsed) {
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    record(static_cast<uint64_t>(micros < 0 ? 0 : micros));
+}
+
+uint64_t LatencyHistogram::count() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::maxMicros() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentileMicros(double percentile) const {
+    uint64_t total = count();
+    if (total == 0) return 0;
+
+    percentile = std::min(100.0, std::max(0.0, percentile));
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total)));
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            // Never report more than the largest value actually seen
+            return std::min(bucketUpperBound(i), maxMicros());
+        }
+    }
+    return maxMicros();
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace WebS
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+
+namespace WebS {
+
+// Fixed-size log-linear histogram in the spirit of HdrHistogram: each power-of-two range
+// of microseconds is split into 16 linear sub-buckets (about 6% worst-case error).
+// Recording is one relaxed atomic add, so it can stay enabled in production.
+class LatencyHistogram {
+public:
+    static constexpr int SubBucketBits = 4;
+    static constexpr int SubBuckets = 1 << SubBucketBits;
+    static constexpr int Magnitudes = 40;                 // Up to ~2^40 us (12 days)
+    static constexpr int BucketCount = Magnitudes * SubBuckets;
+
+    void record(uint64_t micros);
+    void record(std::chrono::steady_clock::duration elapsed);
+
+    uint64_t count() const;
+    uint64_t maxMicros() const;
+    // Upper bound of the bucket holding the given percentile (0-100); 0 when empty
+    uint64_t percentileMicros(double percentile) const;
+    void reset();
+
+private:
+    static int bucketIndex(uint64_t micros);
+    static uint64_t bucketUpperBound(int index);
+
+    std::array<std::atomic<uint64_t>, BucketCount> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// SendMessageAsync timing per hub method, split by where the time went
+struct MethodLatency {
+    LatencyHistogram send;        // SendMessageAsync call -> handed to the transport
+    LatencyHistogram roundTrip;   // handed to the transport -> completion received (network + server)
+    LatencyHistogram dispatch;    // completion received -> Lua callback run (ProcessEvents polling)
+    LatencyHistogram total;       // SendMessageAsync call -> Lua callback run
+
+    void reset() {
+        send.reset();
+        roundTrip.reset();
+        dispatch.reset();
+        total.reset();
+    }
+};
+
+} // namespace WebS
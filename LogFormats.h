@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+
+namespace WebS {
+
+// Ids of the static message formats used with Logger::logf. Binary logs store the id
+// instead of the text, so ids are persisted: append new formats, never renumber.
+enum class LogFormat : uint16_t {
+    Text = 0,                   // Plain message, carried as-is
+    SendCalled,
+    InvokingMethod,
+    SendCompleted,
+    SendAsyncCalled,
+    InvokingAsyncMethod,
+    SendAsyncCompleted,
+    RegisteringMethods,
+    RegisteringHandler,
+    ReceivedServerMethod,
+    Count
+};
+
+inline const char* LogFormatString(LogFormat format) {
+    static const char* const formats[] = {
+        "{}",
+        "Send called: method={}, args={}",
+        "Invoking method: {}",
+        "SendMessage completed successfully for method: {}",
+        "SendAsync called: method={}, args={}, callbackRef={}",
+        "Invoking async method: {}",
+        "SendMessageAsync completed successfully for method: {}",
+        "Registering {} server methods on connection",
+        "  - Registering handler for: {}",
+        "Received server method call: {} with {} args",
+    };
+    static_assert(sizeof(formats) / sizeof(formats[0]) == static_cast<size_t>(LogFormat::Count), "LogFormat table out of sync");
+
+    size_t index = static_cast<size_t>(format);
+    return index < static_cast<size_t>(LogFormat::Count) ? formats[index] : nullptr;
+}
+
+// One raw argument of a structured log record
+struct LogArg {
+    enum class Type : uint8_t { Int = 0, Double = 1, String = 2 };
+
+    Type type = Type::Int;
+    int64_t integer = 0;
+    double number = 0.0;
+    std::string text;
+
+    LogArg() = default;
+    template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    LogArg(T value) : type(Type::Int), integer(static_cast<int64_t>(value)) {}
+    LogArg(double value) : type(Type::Double), number(value) {}
+    LogArg(const std::string& value) : type(Type::String), text(value) {}
+    LogArg(const char* value) : type(Type::String), text(value ? value : "") {}
+
+    void appendTo(std::string& out) const {
+        switch (type) {
+            case Type::Int: out += std::to_string(integer); break;
+            case Type::Double: out += std::to_string(number); break;
+            case Type::String: out += text; break;
+        }
+    }
+};
+
+static constexpr size_t MaxLogArgs = 4;
+
+// Substitutes args into the format's {} placeholders. Shared with the offline decoder,
+// so a decoded binary log reads exactly like the text log.
+inline void FormatLogMessage(LogFormat format, const LogArg* args, size_t count, std::string& out) {
+    const char* pattern = LogFormatString(format);
+    if (!pattern) {
+        out += "<unknown format " + std::to_string(static_cast<unsigned>(format)) + ">";
+        for (size_t i = 0; i < count; ++i) {
+            out += ' ';
+            args[i].appendTo(out);
+        }
+        return;
+    }
+
+    size_t next = 0;
+    for (const char* c = pattern; *c; ++c) {
+        if (c[0] == '{' && c[1] == '}') {
+            if (next < count) args[next++].appendTo(out);
+            ++c;
+        } else {
+            out += *c;
+        }
+    }
+}
+
+// Binary log layout (little-endian). A file is a sequence of blocks, each starting with a
+// kind byte, so sessions can be appended to the same file:
+//   header: 'H' "WSBL" u16 version  i32 utcOffsetMinutes
+//   record: 'R' i64 unixMicros  u8 level  u8 source(0 = level name, 1 = signalr)
+//           u16 formatId  u8 argCount  { u8 type  (i64 | f64 | u32 length + bytes) }*
+namespace BinaryLog {
+    static constexpr char HeaderKind = 'H';
+    static constexpr char RecordKind = 'R';
+    static constexpr char Magic[4] = { 'W', 'S', 'B', 'L' };
+    static constexpr uint16_t Version = 1;
+    static constexpr uint32_t MaxStringLength = 1 << 20;
+}
+
+} // namespace WebS
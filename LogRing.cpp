@@ -0,0 +1,58 @@
+#include "pch.h"
+#include "LogRing.h"
+
+namespace WebS {
+
+namespace {
+
+class SlotLock {
+public:
+    explicit SlotLock(std::atomic_flag& flag) : flag_(flag) {
+        while (flag_.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+    ~SlotLock() {
+        flag_.clear(std::memory_order_release);
+    }
+
+    SlotLock(const SlotLock&) = delete;
+    SlotLock& operator=(const SlotLock&) = delete;
+
+private:
+    std::atomic_flag& flag_;
+};
+
+} // namespace
+
+LogRing::LogRing() : slots_(new Slot[Capacity]) {}
+
+void LogRing::push(const LogRecord& record) {
+    uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[index % Capacity];
+
+    SlotLock lock(slot.busy);
+    // A writer that lapped this one already stored a newer record here
+    if (slot.sequence > index) return;
+    slot.record = record;
+    slot.sequence = index + 1;
+}
+
+std::vector<LogRecord> LogRing::recent(size_t limit, LogLevel minLevel) const {
+    std::vector<LogRecord> records;
+    uint64_t end = next_.load(std::memory_order_relaxed);
+    uint64_t begin = end > Capacity ? end - Capacity : 0;
+
+    for (uint64_t i = end; i > begin && records.size() < limit; --i) {
+        const Slot& slot = slots_[(i - 1) % Capacity];
+        SlotLock lock(slot.busy);
+        // Skip slots still being written or already reused by a newer record
+        if (slot.sequence != i || slot.record.level > minLevel) continue;
+        records.push_back(slot.record);
+    }
+
+    std::reverse(records.begin(), records.end());
+    return records;
+}
+
+} // namespace WebS
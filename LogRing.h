@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Logger.h"
+
+namespace WebS {
+
+// Fixed-size ring of the most recent log records, overwriting the oldest. Writers claim
+// a slot with one atomic increment and only contend when they lap each other on the
+// same slot, so it is cheap enough to keep on regardless of the file log level.
+class LogRing {
+public:
+    static constexpr size_t Capacity = 2048;
+
+    LogRing();
+
+    void push(const LogRecord& record);
+
+    // The newest records at or above minLevel, at most limit of them, oldest first
+    std::vector<LogRecord> recent(size_t limit, LogLevel minLevel) const;
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+private:
+    struct Slot {
+        mutable std::atomic_flag busy = ATOMIC_FLAG_INIT;
+        uint64_t sequence = 0;      // Index + 1 of the record held, 0 while empty
+        LogRecord record;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_{ 0 };
+};
+
+} // namespace WebS
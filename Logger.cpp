@@ -1,9 +1,12 @@
 #include "pch.h"
 #include "Logger.h"
+#include "LogRing.h"
 #include <fstream>
 #include <chrono>
 #include <iomanip>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
 
 namespace WebS {
 
@@ -12,12 +15,98 @@ Logger& Logger::instance() {
     return instance;
 }
 
-std::shared_ptr<Logger> Logger::getShared() {
-    return std::shared_ptr<Logger>(&instance(), [](Logger*) {});
+Logger::Logger() : recent_(new LogRing()) {
+    updateCaptureLevel();
+    lastFlush_ = std::chrono::steady_clock::now();
+    writerRunning_ = true;
+    writer_ = std::make_unique<std::thread>(&Logger::writerThreadFunc, this);
+}
+
+Logger::~Logger() {
+#ifdef _WIN32
+    // Static destruction at process exit: the writer may already have been killed, possibly
+    // holding the file lock, so never join it and only write out what's left if the lock is free
+    if (writer_ && writer_->joinable()) {
+        writer_->detach();
+    }
+#else
+    // Other threads keep running through exit() here, so a detached writer would drain a
+    // destroyed queue: stop it properly when the host never called shutdown
+    if (writer_ && writer_->joinable()) {
+        shutdown(std::chrono::steady_clock::now() + std::chrono::milliseconds(500), false);
+    }
+#endif
+    std::unique_lock<std::mutex> lock(fileMutex_, std::try_to_lock);
+    if (lock.owns_lock()) {
+        drainLocked(true);
+    }
 }
 
 void Logger::setMinLevel(LogLevel level) {
     minLevel_.store(level);
+    updateCaptureLevel();
+}
+
+void Logger::setRecentLevel(LogLevel level) {
+    recentLevel_.store(level);
+    updateCaptureLevel();
+}
+
+LogLevel Logger::recentLevel() const {
+    return recentLevel_.load();
+}
+
+void Logger::updateCaptureLevel() {
+    // None is 0, so the more verbose level is simply the larger one
+    captureLevel_.store(std::max(minLevel_.load(), recentLevel_.load()));
+}
+
+std::vector<LogRecord> Logger::recent(size_t limit, LogLevel minLevel) const {
+    return recent_->recent(limit, minLevel);
+}
+
+int Logger::dumpRecent(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        return -1;
+    }
+
+    std::vector<LogRecord> records = recent_->recent(LogRing::Capacity, LogLevel::Verbose);
+    for (const LogRecord& record : records) {
+        out << formatLine(record) << '\n';
+    }
+    return static_cast<int>(records.size());
+}
+
+void Logger::setRecentDumpPath(const std::string& path) {
+    std::lock_guard<std::mutex> lock(recentDumpMutex_);
+    recentDumpPath_ = path;
+}
+
+std::string Logger::recentDumpPath() const {
+    std::lock_guard<std::mutex> lock(recentDumpMutex_);
+    return recentDumpPath_;
+}
+
+void Logger::dumpRecentOnError() {
+    std::string path;
+    {
+        // A reconnect storm reports OnError on every attempt; one dump per interval is enough
+        std::lock_guard<std::mutex> lock(recentDumpMutex_);
+        auto now = std::chrono::steady_clock::now();
+        bool dumpedRecently = lastRecentDump_.time_since_epoch().count() != 0 &&
+            now - lastRecentDump_ < std::chrono::milliseconds(RecentDumpIntervalMs);
+        if (recentDumpPath_.empty() || dumpedRecently) return;
+        lastRecentDump_ = now;
+        path = recentDumpPath_;
+    }
+
+    int written = dumpRecent(path);
+    if (written < 0) {
+        warning("Failed to write recent log records to: " + path);
+    } else {
+        info("Wrote " + std::to_string(written) + " recent log records to " + path);
+    }
 }
 
 LogLevel Logger::minLevel() const {
@@ -57,31 +146,94 @@ void Logger::luaError(const std::string& eventName, const std::string& err) {
 }
 
 void Logger::clear() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    std::ofstream logfile(filename_, std::ios::trunc);
-    if (logfile.is_open()) {
-        logfile.close();
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    file_.close();
+    std::ofstream truncated(pathFor(openFormat_), std::ios::trunc);
+}
+
+void Logger::setFileFormat(LogFileFormat format) {
+    // Takes effect at the writer's next batch; queued records go to the new file
+    fileFormat_.store(format);
+    wakeWriter();
+}
+
+LogFileFormat Logger::fileFormat() const {
+    return fileFormat_.load();
+}
+
+void Logger::setRotation(LogRotation rotation) {
+    rotation.maxFileBytes = std::max(rotation.maxFileBytes, MinFileBytes);
+    rotation.keepFiles = std::max(0, std::min(rotation.keepFiles, MaxKeepFiles));
+    rotation.maxTotalBytes = std::max(rotation.maxTotalBytes, rotation.maxFileBytes);
+
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    rotation_ = rotation;
+    // Reopened at the next write with the new capacity, rotating first if it's already too big
+    file_.close();
+}
+
+LogRotation Logger::rotation() const {
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    return rotation_;
+}
+
+void Logger::flush() {
+    drain(true);
+}
+
+void Logger::shutdown(std::chrono::steady_clock::time_point deadline, bool underLoaderLock) {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopWriter_ = true;
+    }
+    wakeCv_.notify_all();
+
+    // Wait only until the deadline, like the connection threads, then detach instead of
+    // joining; under the loader lock a finished writer can't exit yet, so it is never joined
+    if (writer_ && writer_->joinable()) {
+        bool done;
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            done = wakeCv_.wait_until(lock, deadline, [this] { return writerDone_; });
+        }
+        if (done && !underLoaderLock) {
+            writer_->join();
+        } else {
+            writer_->detach();
+        }
     }
+    writerRunning_ = false;
+    drain(true);
+
+    // Records logged after this are written synchronously and reopen the file
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    file_.close();
 }
 
 void Logger::log(LogLevel level, const std::string& msg) {
-    if (level > minLevel_.load() || minLevel_.load() == LogLevel::None) {
+    if (!enabled(level)) {
         return;
     }
-    logInternal(LogLevelToString(level), msg);
+    logInternal(level, LogLevelToString(level), msg);
 }
 
 void Logger::write(const std::string& entry) {
+    // Connections keep the trace level they were built with until they are replaced, so the
+    // current level is applied here
+    if (captureLevel_.load(std::memory_order_relaxed) == LogLevel::None) {
+        return;
+    }
+
     std::string levelStr;
     std::string cleanMsg;
     parseSignalRMessage(entry, levelStr, cleanMsg);
 
     LogLevel level = parseSignalRLevel(levelStr);
-    if (level > minLevel_.load() || minLevel_.load() == LogLevel::None) {
+    if (!enabled(level)) {
         return;
     }
 
-    logInternal("signalr", cleanMsg);
+    logInternal(level, "signalr", cleanMsg);
 }
 
 LogLevel Logger::parseSignalRLevel(const std::string& levelStr) {
@@ -127,37 +279,366 @@ void Logger::parseSignalRMessage(const std::string& entry, std::string& outLevel
     }
 }
 
-std::string Logger::formatLevel(const std::string& level) {
-    std::string formatted = level;
-    while (formatted.length() < 9) {
-        formatted += " ";
+void Logger::logInternal(LogLevel level, const char* tag, const std::string& msg) {
+    LogRecord record;
+    record.time = std::chrono::system_clock::now();
+    record.level = level;
+    record.tag = tag;
+    record.message = msg;
+    capture(record);
+}
+
+void Logger::capture(LogRecord& record) {
+    if (record.level <= recentLevel_.load(std::memory_order_relaxed)) {
+        recent_->push(record);
+    }
+    LogLevel fileLevel = minLevel_.load(std::memory_order_relaxed);
+    if (record.level <= fileLevel && fileLevel != LogLevel::None) {
+        enqueue(record);
+    }
+}
+
+void Logger::enqueue(LogRecord& record) {
+    LogLevel level = record.level;
+    if (!queue_.tryPush(record)) {
+        // The writer is behind: help it out rather than lose the line, only dropping if
+        // the queue refills before this thread gets a slot
+        drain(false);
+        if (!queue_.tryPush(record)) {
+            droppedRecords_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    if (!writerRunning_.load()) {
+        drain(true);
+    } else if (level <= LogLevel::Error || queue_.size() >= QueueCapacity / 2) {
+        // Errors must reach the disk before a possible crash; a filling queue must not wait out the timer
+        wakeWriter();
+    }
+}
+
+void Logger::wakeWriter() {
+    if (wakePending_.exchange(true)) return;
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    wakeCv_.notify_one();
+}
+
+void Logger::writerThreadFunc() {
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    while (!stopWriter_) {
+        wakeCv_.wait_for(lock, std::chrono::milliseconds(DrainIntervalMs), [this] {
+            return stopWriter_ || wakePending_.load();
+        });
+        wakePending_ = false;
+
+        lock.unlock();
+        drain(false);
+        lock.lock();
+    }
+
+    lock.unlock();
+    drain(true);
+    lock.lock();
+    writerDone_ = true;
+    lock.unlock();
+    wakeCv_.notify_all();
+}
+
+void Logger::drain(bool forceFlush) {
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    drainLocked(forceFlush);
+}
+
+void Logger::drainLocked(bool forceFlush) {
+    LogFileFormat format = fileFormat_.load();
+    if (format != openFormat_) {
+        file_.close();
+        openFormat_ = format;
+    }
+    auto append = [this, format](const LogRecord& record) {
+        if (format == LogFileFormat::Binary) {
+            appendBinaryRecord(record);
+        } else {
+            appendRecord(record);
+        }
+    };
+
+    bool urgent = false;
+    uint64_t dropped = droppedRecords_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        LogRecord notice;
+        notice.time = std::chrono::system_clock::now();
+        notice.level = LogLevel::Warning;
+        notice.tag = LogLevelToString(LogLevel::Warning);
+        notice.message = std::to_string(dropped) + " log records dropped (queue full)";
+        append(notice);
+    }
+
+    LogRecord record;
+    while (queue_.tryPop(record)) {
+        urgent = urgent || record.level <= LogLevel::Error;
+        append(record);
+        // Batches end on record boundaries, so a rotation never splits a record
+        if (batch_.size() >= MaxBatchBytes) {
+            writeBatch(format);
+        }
+    }
+    writeBatch(format);
+
+    // Mapped writes are visible to readers and survive a crash of the game right away;
+    // flushing only starts writing the pages back to disk
+    auto now = std::chrono::steady_clock::now();
+    if (forceFlush || urgent || now - lastFlush_ >= std::chrono::milliseconds(FlushIntervalMs)) {
+        file_.flush();
+        lastFlush_ = now;
+    }
+}
+
+void Logger::writeBatch(LogFileFormat format) {
+    if (batch_.empty()) return;
+
+    if (!file_.isOpen()) {
+        openFile(format);
+    }
+    if (!file_.isOpen()) {
+        // Can't log the failure to open the log; keep going without a file
+        batch_.clear();
+        return;
+    }
+    if (!file_.write(batch_.data(), batch_.size())) {
+        rotateFiles(format);
+        openFile(format);
+        // Only a batch bigger than a whole file can fail again; it is dropped
+        file_.write(batch_.data(), batch_.size());
+    }
+    batch_.clear();
+}
+
+#ifdef _WIN32
+static const char LineEnding[] = "\r\n";
+#else
+static const char LineEnding[] = "\n";
+#endif
+
+static void toLocalTime(std::time_t time, struct tm& out) {
+#ifdef _WIN32
+    localtime_s(&out, &time);
+#else
+    localtime_r(&time, &out);
+#endif
+}
+
+static void toUtcTime(std::time_t time, struct tm& out) {
+#ifdef _WIN32
+    gmtime_s(&out, &time);
+#else
+    gmtime_r(&time, &out);
+#endif
+}
+
+// Length without trailing line breaks; the writer adds its own
+static size_t trimmedLength(const std::string& message) {
+    size_t end = message.size();
+    while (end > 0 && (message[end - 1] == '\n' || message[end - 1] == '\r')) {
+        end--;
+    }
+    return end;
+}
+
+static void appendMessage(const LogRecord& record, std::string& out) {
+    if (record.format == LogFormat::Text) {
+        out.append(record.message, 0, trimmedLength(record.message));
+    } else {
+        FormatLogMessage(record.format, record.args.data(), record.argCount, out);
     }
-    return formatted;
 }
 
-void Logger::logInternal(const std::string& level, const std::string& msg) {
-    std::lock_guard<std::mutex> lock(mutex_);
+std::string Logger::formatTimestamp(const LogRecord& record) {
+    auto time = std::chrono::system_clock::to_time_t(record.time);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count() % 1000;
+
+    struct tm timeinfo;
+    toLocalTime(time, timeinfo);
+    char seconds[32];
+    strftime(seconds, sizeof(seconds), "%Y-%m-%d %H:%M:%S", &timeinfo);
 
-    std::ofstream logfile(filename_, std::ios::app);
-    if (logfile.is_open()) {
-        auto now = std::chrono::system_clock::now();
-        auto time = std::chrono::system_clock::to_time_t(now);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
+    char timestamp[40];
+    snprintf(timestamp, sizeof(timestamp), "%s.%03d", seconds, static_cast<int>(ms));
+    return timestamp;
+}
 
+std::string Logger::formatMessage(const LogRecord& record) {
+    std::string message;
+    appendMessage(record, message);
+    return message;
+}
+
+std::string Logger::formatLine(const LogRecord& record) {
+    char tag[16];
+    snprintf(tag, sizeof(tag), "%-9s", record.tag);
+    return "[" + formatTimestamp(record) + "] [" + tag + "] " + formatMessage(record);
+}
+
+void Logger::appendRecord(const LogRecord& record) {
+    auto time = std::chrono::system_clock::to_time_t(record.time);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count() % 1000;
+
+    // toLocalTime and strftime only run when the second changes
+    if (time != cachedSecond_ || cachedTimestamp_[0] == '\0') {
         struct tm timeinfo;
-        localtime_s(&timeinfo, &time);
+        toLocalTime(time, timeinfo);
+        strftime(cachedTimestamp_, sizeof(cachedTimestamp_), "%Y-%m-%d %H:%M:%S", &timeinfo);
+        cachedSecond_ = time;
+    }
+
+    char prefix[64];
+    int length = snprintf(prefix, sizeof(prefix), "[%s.%03d] [%-9s] ", cachedTimestamp_, static_cast<int>(ms), record.tag);
+    batch_.append(prefix, static_cast<size_t>(std::max(0, std::min(length, static_cast<int>(sizeof(prefix)) - 1))));
 
-        char buffer[32];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
+    appendMessage(record, batch_);
+    batch_ += LineEnding;
+}
 
-        std::string cleanMsg = msg;
-        while (!cleanMsg.empty() && (cleanMsg.back() == '\n' || cleanMsg.back() == '\r')) {
-            cleanMsg.pop_back();
+template<typename T>
+static void appendRaw(std::string& out, T value) {
+    // The binary format is little-endian, like every platform this builds for
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+static void appendString(std::string& out, const std::string& text, size_t size) {
+    uint32_t length = static_cast<uint32_t>(std::min<size_t>(size, BinaryLog::MaxStringLength));
+    appendRaw(out, length);
+    out.append(text, 0, length);
+}
+
+void Logger::appendBinaryRecord(const LogRecord& record) {
+    int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(record.time.time_since_epoch()).count();
+
+    batch_ += BinaryLog::RecordKind;
+    appendRaw(batch_, micros);
+    appendRaw(batch_, static_cast<uint8_t>(record.level));
+    appendRaw(batch_, static_cast<uint8_t>(std::strcmp(record.tag, "signalr") == 0 ? 1 : 0));
+    appendRaw(batch_, static_cast<uint16_t>(record.format));
+
+    if (record.format == LogFormat::Text) {
+        appendRaw(batch_, static_cast<uint8_t>(1));
+        appendRaw(batch_, static_cast<uint8_t>(LogArg::Type::String));
+        appendString(batch_, record.message, trimmedLength(record.message));
+        return;
+    }
+
+    appendRaw(batch_, record.argCount);
+    for (uint8_t i = 0; i < record.argCount; ++i) {
+        const LogArg& arg = record.args[i];
+        appendRaw(batch_, static_cast<uint8_t>(arg.type));
+        switch (arg.type) {
+            case LogArg::Type::Int: appendRaw(batch_, arg.integer); break;
+            case LogArg::Type::Double: appendRaw(batch_, arg.number); break;
+            case LogArg::Type::String: appendString(batch_, arg.text, arg.text.size()); break;
         }
+    }
+}
+
+const std::string& Logger::pathFor(LogFileFormat format) const {
+    return format == LogFileFormat::Binary ? binaryFilename_ : filename_;
+}
+
+// websocketLogging.txt -> websocketLogging.<index>.txt
+static std::string rotatedPath(const std::string& path, int index) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return path + "." + std::to_string(index);
+    }
+    return path.substr(0, dot) + "." + std::to_string(index) + path.substr(dot);
+}
 
-        logfile << "[" << buffer << "." << std::setfill('0') << std::setw(3) << ms.count()
-                << "] [" << formatLevel(level) << "] " << cleanMsg << std::endl;
+// Returns false if the file doesn't exist
+static bool inspectFile(const std::string& path, uint64_t& size, char& lastByte) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return false;
+
+    size = static_cast<uint64_t>(in.tellg());
+    lastByte = 0;
+    if (size > 0) {
+        in.seekg(-1, std::ios::end);
+        in.get(lastByte);
     }
+    return true;
+}
+
+void Logger::rotateFiles(LogFileFormat format) {
+    file_.close();
+
+    const std::string& path = pathFor(format);
+    int keep = rotation_.keepFiles;
+    // Also drops files left over from a larger keepFiles
+    for (int i = keep + 1; i <= MaxKeepFiles; ++i) {
+        std::remove(rotatedPath(path, i).c_str());
+    }
+    if (keep > 0) {
+        std::remove(rotatedPath(path, keep).c_str());
+        for (int i = keep - 1; i >= 1; --i) {
+            std::rename(rotatedPath(path, i).c_str(), rotatedPath(path, i + 1).c_str());
+        }
+        std::rename(path.c_str(), rotatedPath(path, 1).c_str());
+    } else {
+        std::remove(path.c_str());
+    }
+
+    // The current file can grow to maxFileBytes; rotated files share what's left, newest first
+    uint64_t budget = rotation_.maxTotalBytes - rotation_.maxFileBytes;
+    uint64_t used = 0;
+    bool overBudget = false;
+    for (int i = 1; i <= keep; ++i) {
+        std::string rotated = rotatedPath(path, i);
+        uint64_t size = 0;
+        char lastByte = 0;
+        if (!inspectFile(rotated, size, lastByte)) continue;
+
+        if (overBudget || used + size > budget) {
+            overBudget = true;
+            std::remove(rotated.c_str());
+        } else {
+            used += size;
+        }
+    }
+}
+
+void Logger::openFile(LogFileFormat format) {
+    const std::string& path = pathFor(format);
+
+    // A zero last byte is preallocated space left by a session that never closed the file;
+    // where its data ends can't be told reliably, so it is rotated away intact
+    uint64_t size = 0;
+    char lastByte = 0;
+    if (inspectFile(path, size, lastByte) && (size >= rotation_.maxFileBytes || (size > 0 && lastByte == '\0'))) {
+        rotateFiles(format);
+    }
+
+    if (!file_.open(path, rotation_.maxFileBytes) || format == LogFileFormat::Text) {
+        return;
+    }
+
+    // Each session starts with a header so the decoder can render local times
+    std::time_t now = std::time(nullptr);
+    struct tm local;
+    struct tm utc;
+    toLocalTime(now, local);
+    toUtcTime(now, utc);
+    int dayDiff = local.tm_yday - utc.tm_yday;
+    if (dayDiff > 1) dayDiff = -1;
+    if (dayDiff < -1) dayDiff = 1;
+    int32_t offsetMinutes = dayDiff * 1440 + (local.tm_hour - utc.tm_hour) * 60 + (local.tm_min - utc.tm_min);
+
+    std::string header;
+    header += BinaryLog::HeaderKind;
+    header.append(BinaryLog::Magic, sizeof(BinaryLog::Magic));
+    appendRaw(header, BinaryLog::Version);
+    appendRaw(header, offsetMinutes);
+    file_.write(header.data(), header.size());
 }
 
 } // namespace WebS
@@ -4,7 +4,16 @@
 #include <mutex>
 #include <memory>
 #include <atomic>
-#include "signalrclient/hub_connection.h"
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <condition_variable>
+#include <ctime>
+#include <array>
+#include <vector>
+#include "BoundedQueue.h"
+#include "LogFormats.h"
+#include "MappedLogFile.h"
 
 namespace WebS {
 
@@ -42,16 +51,83 @@ inline LogLevel StringToLogLevel(const std::string& str) {
     return LogLevel::Info;
 }
 
-class Logger : public signalr::log_writer {
+enum class LogFileFormat {
+    Text,       // websocketLogging.txt
+    Binary      // websocketLogging.bin, decoded offline by tools/logdecode
+};
+
+inline const char* LogFileFormatToString(LogFileFormat format) {
+    return format == LogFileFormat::Binary ? "binary" : "text";
+}
+
+inline LogFileFormat StringToLogFileFormat(const std::string& str) {
+    return str == "binary" ? LogFileFormat::Binary : LogFileFormat::Text;
+}
+
+// Size-based rotation: websocketLogging.txt -> websocketLogging.1.txt -> ... -> .<keepFiles>.txt
+struct LogRotation {
+    uint64_t maxFileBytes = 8ull << 20;     // Also the preallocated size of the current file
+    int keepFiles = 3;                      // Rotated files kept besides the current one
+    uint64_t maxTotalBytes = 32ull << 20;   // Current plus rotated files; oldest are deleted first
+};
+
+// A log line captured on the calling thread and formatted later by the writer
+struct LogRecord {
+    std::chrono::system_clock::time_point time;
+    LogLevel level = LogLevel::Info;
+    const char* tag = "";       // Static: the level name, or "signalr"
+    LogFormat format = LogFormat::Text;
+    std::string message;        // LogFormat::Text only
+    uint8_t argCount = 0;
+    std::array<LogArg, MaxLogArgs> args;
+};
+
+class LogRing;
+
+// Callers only enqueue a record; a background thread formats and writes them in
+// batches to a file it keeps open.
+class Logger {
 public:
+    static constexpr size_t QueueCapacity = 8192;   // When full, the logging thread drains it itself
+    static constexpr int DrainIntervalMs = 50;
+    static constexpr int FlushIntervalMs = 1000;    // Error and critical records flush immediately
+    static constexpr size_t MaxBatchBytes = 64 * 1024;
+
     static Logger& instance();
-    static std::shared_ptr<Logger> getShared();
 
-    void write(const std::string& entry) override;
+    // Takes a trace line from the hub client ("<time> [<level>] <message>") and logs it
+    // under the "signalr" tag at the level it names
+    void write(const std::string& entry);
 
     void setMinLevel(LogLevel level);
     LogLevel minLevel() const;
 
+    // Check before building a message on a hot path, so a disabled level costs one load.
+    // True when either the file or the recent-records ring takes the level.
+    bool enabled(LogLevel level) const {
+        return level <= captureLevel_.load(std::memory_order_relaxed);
+    }
+
+    // Info, not Debug: the per-send Debug records would otherwise be built with logging off
+    static constexpr LogLevel DefaultRecentLevel = LogLevel::Info;
+    static constexpr int RecentDumpIntervalMs = 10000;
+
+    // The in-memory ring of recent records, kept independently of the file level
+    void setRecentLevel(LogLevel level);
+    LogLevel recentLevel() const;
+    std::vector<LogRecord> recent(size_t limit, LogLevel minLevel) const;
+    // Writes the ring as text; returns the number of records, -1 if the file can't be opened
+    int dumpRecent(const std::string& path) const;
+    // Where the ring is dumped when a client reports OnError; empty disables it
+    void setRecentDumpPath(const std::string& path);
+    std::string recentDumpPath() const;
+    void dumpRecentOnError();
+
+    // "[2024-01-01 12:00:00.000] [level    ] message" in local time, without a line break
+    static std::string formatLine(const LogRecord& record);
+    static std::string formatTimestamp(const LogRecord& record);
+    static std::string formatMessage(const LogRecord& record);
+
     void critical(const std::string& msg);
     void error(const std::string& msg);
     void warning(const std::string& msg);
@@ -62,24 +138,100 @@ public:
     void success(const std::string& msg);
     void luaError(const std::string& eventName, const std::string& err);
 
+    // Structured log: only the format id and raw args are captured; text is built by the
+    // writer (text file) or by the offline decoder (binary file)
+    template<typename... Args>
+    void logf(LogLevel level, LogFormat format, const Args&... args) {
+        static_assert(sizeof...(Args) <= MaxLogArgs, "Too many log arguments");
+        if (!enabled(level)) return;
+
+        LogRecord record;
+        record.time = std::chrono::system_clock::now();
+        record.level = level;
+        record.tag = LogLevelToString(level);
+        record.format = format;
+        record.argCount = static_cast<uint8_t>(sizeof...(Args));
+        size_t index = 0;
+        int expand[] = { 0, (record.args[index++] = LogArg(args), 0)... };
+        (void)expand;
+        capture(record);
+    }
+
+    void setFileFormat(LogFileFormat format);
+    LogFileFormat fileFormat() const;
+
+    static constexpr uint64_t MinFileBytes = MappedLogFile::SegmentBytes;
+    static constexpr int MaxKeepFiles = 20;
+    // Clamps the limits to sane values; applies from the next write
+    void setRotation(LogRotation rotation);
+    LogRotation rotation() const;
+
     void clear();
 
+    // Writes everything queued so far and flushes the file
+    void flush();
+    // Stops the writer (waiting for it only until the deadline); later records are written synchronously.
+    // underLoaderLock: called from DllMain, so the writer is detached even once it has finished.
+    void shutdown(std::chrono::steady_clock::time_point deadline, bool underLoaderLock);
+
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
 private:
-    Logger() = default;
-    ~Logger() = default;
+    Logger();
+    ~Logger();
 
     void log(LogLevel level, const std::string& msg);
-    void logInternal(const std::string& level, const std::string& msg);
+    void logInternal(LogLevel level, const char* tag, const std::string& msg);
+    void capture(LogRecord& record);
+    void enqueue(LogRecord& record);
+    void updateCaptureLevel();
     void parseSignalRMessage(const std::string& entry, std::string& outLevel, std::string& outMessage);
     LogLevel parseSignalRLevel(const std::string& levelStr);
-    std::string formatLevel(const std::string& level);
 
-    std::mutex mutex_;
+    void wakeWriter();
+    void writerThreadFunc();
+    void drain(bool forceFlush);
+    void drainLocked(bool forceFlush);
+    void appendRecord(const LogRecord& record);
+    void appendBinaryRecord(const LogRecord& record);
+    void openFile(LogFileFormat format);
+    void writeBatch(LogFileFormat format);
+    void rotateFiles(LogFileFormat format);
+    const std::string& pathFor(LogFileFormat format) const;
+
     std::atomic<LogLevel> minLevel_{ LogLevel::Info };
+    std::atomic<LogLevel> recentLevel_{ DefaultRecentLevel };
+    std::atomic<LogLevel> captureLevel_{ DefaultRecentLevel };   // The more verbose of the two
+
+    std::unique_ptr<LogRing> recent_;
+    mutable std::mutex recentDumpMutex_;
+    std::string recentDumpPath_ = "websocketLogging.recent.txt";
+    std::chrono::steady_clock::time_point lastRecentDump_;
     const std::string filename_ = "websocketLogging.txt";
+    const std::string binaryFilename_ = "websocketLogging.bin";
+    std::atomic<LogFileFormat> fileFormat_{ LogFileFormat::Text };
+
+    BoundedQueue<LogRecord> queue_{ QueueCapacity };
+    std::atomic<uint64_t> droppedRecords_{ 0 };
+    std::atomic<bool> writerRunning_{ false };
+    std::atomic<bool> wakePending_{ false };
+
+    std::unique_ptr<std::thread> writer_;
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+    bool stopWriter_ = false;
+    bool writerDone_ = false;
+
+    // Writer side: the open file, the batch being formatted and the per-second timestamp cache
+    mutable std::mutex fileMutex_;
+    MappedLogFile file_;
+    LogFileFormat openFormat_ = LogFileFormat::Text;
+    LogRotation rotation_;
+    std::string batch_;
+    std::time_t cachedSecond_ = 0;
+    char cachedTimestamp_[32] = {};
+    std::chrono::steady_clock::time_point lastFlush_;
 };
 
 } // namespace WebS
@@ -2,7 +2,9 @@
 #include "LuaBindings.h"
 #include "WebSClient.h"
 #include "Logger.h"
+#include "Tracer.h"
 #include "Types.h"
+#include "MessageFilter.h"
 #include "Version.h"
 
 extern "C" {
@@ -13,15 +15,31 @@ namespace WebS {
 	namespace LuaBindings {
 
 		static const std::set<std::string> internalEvents = {
-			"OnConnect", "OnDisconnect", "OnError", "OnReconnecting", "OnReconnected"
+			"OnConnect", "OnDisconnect", "OnError", "OnReconnecting", "OnReconnected", "OnSlowHandler", "OnReplayDone"
 		};
 
 		static bool isInternalEvent(const std::string& name) {
 			return internalEvents.find(name) != internalEvents.end();
 		}
 
-		static std::vector<signalr::value> tableToArgs(lua_State* L, int index) {
-			std::vector<signalr::value> args;
+		// Client functions carry their WebSClient as upvalue 1: the default client for the
+		// global WebS table, a named one for tables returned by NewClient.
+		static WebSClient& client(lua_State* L) {
+			WebSClient* ws = static_cast<WebSClient*>(lua_touserdata(L, lua_upvalueindex(1)));
+			if (!ws) ws = &WebSClient::instance();
+
+			// Accept method-call syntax on client objects: c:Connect(url)
+			if (lua_istable(L, 1)) {
+				lua_getfield(L, 1, "__client");
+				bool isSelf = lua_touserdata(L, -1) == ws;
+				lua_pop(L, 1);
+				if (isSelf) lua_remove(L, 1);
+			}
+			return *ws;
+		}
+
+		std::vector<Value> tableToArgs(lua_State* L, int index) {
+			std::vector<Value> args;
 			int arraySize = static_cast<int>(lua_objlen(L, index));
 
 			for (int i = 1; i <= arraySize; ++i) {
@@ -41,11 +59,106 @@ namespace WebS {
 			return args;
 		}
 
+		static void readStringOption(lua_State* L, int index, const char* key, std::string& out) {
+			lua_getfield(L, index, key);
+			if (!lua_isnil(L, -1)) {
+				if (!lua_isstring(L, -1)) {
+					luaL_error(L, "Connect: option '%s' must be a string", key);
+				}
+				out = lua_tostring(L, -1);
+			}
+			lua_pop(L, 1);
+		}
+
+		static void readIntOption(lua_State* L, int index, const char* key, int& out) {
+			lua_getfield(L, index, key);
+			if (!lua_isnil(L, -1)) {
+				if (!lua_isnumber(L, -1)) {
+					luaL_error(L, "Connect: option '%s' must be a number", key);
+				}
+				out = static_cast<int>(lua_tointeger(L, -1));
+			}
+			lua_pop(L, 1);
+		}
+
+		static ConnectOptions tableToConnectOptions(lua_State* L, int index) {
+			ConnectOptions options;
+			readStringOption(L, index, "token", options.token);
+			readStringOption(L, index, "transport", options.transport);
+			readStringOption(L, index, "proxy", options.proxy);
+			readIntOption(L, index, "connectTimeoutMs", options.connectTimeoutMs);
+			readIntOption(L, index, "handshakeTimeoutMs", options.handshakeTimeoutMs);
+			readIntOption(L, index, "keepAliveMs", options.keepAliveMs);
+			readIntOption(L, index, "serverTimeoutMs", options.serverTimeoutMs);
+
+			readStringOption(L, index, "standbyUrl", options.standbyUrl);
+
+			lua_getfield(L, index, "urls");
+			if (lua_istable(L, -1)) {
+				int urlsIndex = lua_gettop(L);
+				int count = static_cast<int>(lua_objlen(L, urlsIndex));
+				for (int i = 1; i <= count; ++i) {
+					lua_rawgeti(L, urlsIndex, i);
+					if (!lua_isstring(L, -1)) {
+						luaL_error(L, "Connect: 'urls' must contain only strings");
+					}
+					options.urls.push_back(lua_tostring(L, -1));
+					lua_pop(L, 1);
+				}
+			}
+			else if (!lua_isnil(L, -1)) {
+				luaL_error(L, "Connect: option 'urls' must be a table");
+			}
+			lua_pop(L, 1);
+			lua_getfield(L, index, "skipNegotiation");
+			options.skipNegotiation = lua_toboolean(L, -1) != 0;
+			lua_pop(L, 1);
+
+			lua_getfield(L, index, "standby");
+			options.standby = lua_toboolean(L, -1) != 0 || !options.standbyUrl.empty();
+			lua_pop(L, 1);
+
+			lua_getfield(L, index, "scheduler");
+			if (lua_istable(L, -1)) {
+				int schedulerIndex = lua_gettop(L);
+				options.scheduler.enabled = true;
+				readIntOption(L, schedulerIndex, "threads", options.scheduler.threads);
+				readStringOption(L, schedulerIndex, "priority", options.scheduler.priority);
+
+				lua_getfield(L, schedulerIndex, "affinity");
+				if (lua_isnumber(L, -1)) {
+					options.scheduler.affinityMask = static_cast<uint64_t>(lua_tonumber(L, -1));
+				}
+				lua_pop(L, 1);
+			}
+			else if (!lua_isnil(L, -1)) {
+				luaL_error(L, "Connect: option 'scheduler' must be a table");
+			}
+			lua_pop(L, 1);
+			return options;
+		}
+
 		int Connect(lua_State* L) {
+			WebSClient& ws = client(L);
 			int numArgs = lua_gettop(L);
 
 			if (numArgs < 1 || numArgs > 2) {
-				return luaL_error(L, "Connect: One or Two arguments expected (url, [token])");
+				return luaL_error(L, "Connect: One or Two arguments expected (url, [token or options]) or (options)");
+			}
+
+			// Connect({urls = {...}, ...}) picks among several endpoints
+			if (numArgs == 1 && lua_istable(L, 1)) {
+				ConnectOptions options = tableToConnectOptions(L, 1);
+				if (options.urls.empty()) {
+					return luaL_error(L, "Connect: options table needs a non-empty 'urls' list");
+				}
+				bool result = ws.connect("", options);
+				lua_pushboolean(L, result);
+				if (!result) {
+					lua_pushstring(L, "Connection failed to start");
+					return 2;
+				}
+				return 1;
 			}
 
 			if (!lua_isstring(L, 1)) {
@@ -53,9 +166,15 @@ namespace WebS {
 			}
 
 			std::string url = lua_tostring(L, 1);
-			std::string token = (numArgs == 2 && lua_isstring(L, 2)) ? lua_tostring(L, 2) : "";
+			ConnectOptions options;
+			if (numArgs == 2 && lua_istable(L, 2)) {
+				options = tableToConnectOptions(L, 2);
+			}
+			else if (numArgs == 2 && lua_isstring(L, 2)) {
+				options.token = lua_tostring(L, 2);
+			}
 
-			bool result = WebSClient::instance().connect(url, token);
+			bool result = ws.connect(url, options);
 			lua_pushboolean(L, result);
 
 			if (!result) {
@@ -67,12 +186,14 @@ namespace WebS {
 		}
 
 		int Disconnect(lua_State* L) {
-			WebSClient::instance().disconnect();
+			WebSClient& ws = client(L);
+			ws.disconnect();
 			lua_pushboolean(L, true);
 			return 1;
 		}
 
 		int Send(lua_State* L) {
+			WebSClient& ws = client(L);
 			int numArgs = lua_gettop(L);
 
 			if (numArgs != 2) {
@@ -83,16 +204,16 @@ namespace WebS {
 				return luaL_error(L, "Arguments must be (string, table)");
 			}
 
-			if (WebSClient::instance().status() != ConnectionStatus::CONNECTED) {
+			if (ws.status() != ConnectionStatus::CONNECTED) {
 				lua_pushboolean(L, false);
 				lua_pushstring(L, "Not connected");
 				return 2;
 			}
 
 			const char* methodName = lua_tostring(L, 1);
-			std::vector<signalr::value> args = tableToArgs(L, 2);
+			std::vector<Value> args = tableToArgs(L, 2);
 
-			bool result = WebSClient::instance().send(methodName, args);
+			bool result = ws.send(methodName, args);
 			lua_pushboolean(L, result);
 
 			if (!result) {
@@ -104,6 +225,7 @@ namespace WebS {
 		}
 
 		int SendAsync(lua_State* L) {
+			WebSClient& ws = client(L);
 			int numArgs = lua_gettop(L);
 
 			if (numArgs < 3) {
@@ -114,7 +236,7 @@ namespace WebS {
 				return luaL_error(L, "Arguments: (string, table, function)");
 			}
 
-			if (WebSClient::instance().status() != ConnectionStatus::CONNECTED) {
+			if (ws.status() != ConnectionStatus::CONNECTED) {
 				lua_pushboolean(L, false);
 				lua_pushstring(L, "Not connected");
 				return 2;
@@ -125,9 +247,9 @@ namespace WebS {
 			lua_pushvalue(L, 3);
 			int callbackRef = luaL_ref(L, LUA_REGISTRYINDEX);
 
-			std::vector<signalr::value> args = tableToArgs(L, 2);
+			std::vector<Value> args = tableToArgs(L, 2);
 
-			bool result = WebSClient::instance().sendAsync(methodName, args, callbackRef);
+			bool result = ws.sendAsync(L, methodName, args, callbackRef);
 
 			if (!result) {
 				luaL_unref(L, LUA_REGISTRYINDEX, callbackRef);
@@ -141,59 +263,217 @@ namespace WebS {
 		}
 
 		int GetMsg(lua_State* L) {
-			std::string msg = WebSClient::instance().getMessage();
+			WebSClient& ws = client(L);
+			std::string msg = ws.context(L)->getMessage();
 			lua_pushstring(L, msg.c_str());
 			return 1;
 		}
 
 		int GetQueueSize(lua_State* L) {
-			lua_pushinteger(L, static_cast<int>(WebSClient::instance().queueSize()));
+			WebSClient& ws = client(L);
+			lua_pushinteger(L, static_cast<int>(ws.context(L)->queueSize()));
 			return 1;
 		}
 
 		int GetStatus(lua_State* L) {
-			ConnectionStatus status = WebSClient::instance().status();
+			WebSClient& ws = client(L);
+			ConnectionStatus status = ws.status();
 			lua_pushstring(L, ConnectionStatusToString(status));
 			return 1;
 		}
 
 		int GetConnectionId(lua_State* L) {
-			std::string connId = WebSClient::instance().connectionId();
+			WebSClient& ws = client(L);
+			std::string connId = ws.connectionId();
 			lua_pushstring(L, connId.c_str());
 			return 1;
 		}
 
 		int ProcessEvents(lua_State* L) {
-			int processed = WebSClient::instance().processEvents(L);
+			WebSClient& ws = client(L);
+			int processed = ws.processEvents(L);
 			lua_pushinteger(L, processed);
 			return 1;
 		}
 
+		static Value luaScalarToValue(lua_State* L, int index) {
+			switch (lua_type(L, index)) {
+				case LUA_TSTRING: return Value(std::string(lua_tostring(L, index)));
+				case LUA_TNUMBER: return Value(static_cast<double>(lua_tonumber(L, index)));
+				case LUA_TBOOLEAN: return Value(lua_toboolean(L, index) != 0);
+				default: return Value();
+			}
+		}
+
+		// Parses { argIndex=1, field="a.b", equals=v, prefix="s", min=n, max=n, oneOf={...} }
+		static std::shared_ptr<const MessageFilter> tableToFilter(lua_State* L, int index) {
+			auto filter = std::make_shared<MessageFilter>();
+
+			lua_getfield(L, index, "argIndex");
+			if (!lua_isnil(L, -1)) {
+				filter->argIndex = static_cast<int>(lua_tointeger(L, -1));
+				if (filter->argIndex < 1) {
+					luaL_error(L, "On: filter.argIndex must be >= 1");
+				}
+			}
+			lua_pop(L, 1);
+
+			lua_getfield(L, index, "field");
+			if (lua_isstring(L, -1)) {
+				std::string path = lua_tostring(L, -1);
+				size_t start = 0;
+				while (start <= path.size()) {
+					size_t dot = path.find('.', start);
+					if (dot == std::string::npos) dot = path.size();
+					if (dot > start) filter->fieldPath.push_back(path.substr(start, dot - start));
+					start = dot + 1;
+				}
+			}
+			lua_pop(L, 1);
+
+			lua_getfield(L, index, "equals");
+			if (!lua_isnil(L, -1)) {
+				int type = lua_type(L, -1);
+				if (type != LUA_TSTRING && type != LUA_TNUMBER && type != LUA_TBOOLEAN) {
+					luaL_error(L, "On: filter.equals must be a string, number or boolean");
+				}
+				filter->hasEquals = true;
+				filter->equals = luaScalarToValue(L, -1);
+			}
+			lua_pop(L, 1);
+
+			lua_getfield(L, index, "prefix");
+			if (!lua_isnil(L, -1)) {
+				if (lua_type(L, -1) != LUA_TSTRING) {
+					luaL_error(L, "On: filter.prefix must be a string");
+				}
+				filter->hasPrefix = true;
+				filter->prefix = lua_tostring(L, -1);
+			}
+			lua_pop(L, 1);
+
+			lua_getfield(L, index, "min");
+			if (!lua_isnil(L, -1)) {
+				if (lua_type(L, -1) != LUA_TNUMBER) {
+					luaL_error(L, "On: filter.min must be a number");
+				}
+				filter->hasMin = true;
+				filter->min = lua_tonumber(L, -1);
+			}
+			lua_pop(L, 1);
+
+			lua_getfield(L, index, "max");
+			if (!lua_isnil(L, -1)) {
+				if (lua_type(L, -1) != LUA_TNUMBER) {
+					luaL_error(L, "On: filter.max must be a number");
+				}
+				filter->hasMax = true;
+				filter->max = lua_tonumber(L, -1);
+			}
+			lua_pop(L, 1);
+
+			lua_getfield(L, index, "oneOf");
+			if (lua_istable(L, -1)) {
+				int count = static_cast<int>(lua_objlen(L, -1));
+				for (int i = 1; i <= count; ++i) {
+					lua_rawgeti(L, -1, i);
+					if (lua_type(L, -1) == LUA_TSTRING) {
+						filter->oneOfStrings.insert(lua_tostring(L, -1));
+					} else if (lua_type(L, -1) == LUA_TNUMBER) {
+						filter->oneOfNumbers.insert(lua_tonumber(L, -1));
+					}
+					lua_pop(L, 1);
+				}
+				if (filter->oneOfStrings.empty() && filter->oneOfNumbers.empty()) {
+					luaL_error(L, "On: filter.oneOf must contain strings or numbers");
+				}
+			}
+			lua_pop(L, 1);
+
+			return filter;
+		}
+
+		static std::shared_ptr<const MessageFilter> optionsToFilter(lua_State* L, int index) {
+			std::shared_ptr<const MessageFilter> filter;
+			lua_getfield(L, index, "filter");
+			if (lua_istable(L, -1)) {
+				filter = tableToFilter(L, lua_gettop(L));
+			}
+			lua_pop(L, 1);
+			return filter;
+		}
+
 		int On(lua_State* L) {
+			WebSClient& ws = client(L);
 			int numArgs = lua_gettop(L);
 
-			if (numArgs != 2) {
-				return luaL_error(L, "Usage: On(eventName, callback)");
+			if (numArgs < 2 || numArgs > 3) {
+				return luaL_error(L, "Usage: On(eventName, callback, [options])");
 			}
 
 			if (!lua_isstring(L, 1) || !lua_isfunction(L, 2)) {
-				return luaL_error(L, "Arguments must be (string, function)");
+				return luaL_error(L, "Arguments must be (string, function, [table])");
 			}
 
 			const char* eventName = lua_tostring(L, 1);
 			std::string eventStr(eventName);
 
-			if (!isInternalEvent(eventStr)) {
-				WebSClient::instance().registerServerMethod(eventStr);
+			std::shared_ptr<const MessageFilter> filter;
+			if (numArgs == 3 && lua_istable(L, 3)) {
+				if (isInternalEvent(eventStr)) {
+					lua_getfield(L, 3, "filter");
+					if (!lua_isnil(L, -1)) {
+						return luaL_error(L, "On: filters are only supported for server methods");
+					}
+					lua_pop(L, 1);
+				}
+				filter = optionsToFilter(L, 3);
 			}
 
-			int ref = WebSClient::instance().events().on(L, eventStr, 2);
+			int ref = ws.context(L)->events().on(L, eventStr, 2);
+
+			if (ref != -1 && !isInternalEvent(eventStr)) {
+				ws.registerServerMethod(L, eventStr, ref, std::move(filter));
+			}
+
+			lua_pushinteger(L, ref);
+			return 1;
+		}
+
+		int OnBatch(lua_State* L) {
+			WebSClient& ws = client(L);
+			int numArgs = lua_gettop(L);
+
+			if (numArgs < 2 || numArgs > 3) {
+				return luaL_error(L, "Usage: OnBatch(methodName, callback, [options])");
+			}
+
+			if (!lua_isstring(L, 1) || !lua_isfunction(L, 2)) {
+				return luaL_error(L, "Arguments must be (string, function, [table])");
+			}
+
+			std::string methodStr(lua_tostring(L, 1));
+			if (isInternalEvent(methodStr)) {
+				return luaL_error(L, "OnBatch: only server methods can be batched");
+			}
+
+			std::shared_ptr<const MessageFilter> filter;
+			if (numArgs == 3 && lua_istable(L, 3)) {
+				filter = optionsToFilter(L, 3);
+			}
+
+			int ref = ws.context(L)->events().onBatch(L, methodStr, 2);
+
+			if (ref != -1) {
+				ws.registerServerMethod(L, methodStr, ref, std::move(filter));
+			}
 
 			lua_pushinteger(L, ref);
 			return 1;
 		}
 
 		int Off(lua_State* L) {
+			WebSClient& ws = client(L);
 			int numArgs = lua_gettop(L);
 
 			if (numArgs != 2) {
@@ -207,15 +487,21 @@ namespace WebS {
 			const char* eventName = lua_tostring(L, 1);
 			int callbackRef = static_cast<int>(lua_tointeger(L, 2));
 
-			WebSClient::instance().events().off(L, eventName, callbackRef);
+			std::string eventStr(eventName);
+			ws.context(L)->events().off(L, eventStr, callbackRef);
+
+			if (!isInternalEvent(eventStr)) {
+				ws.unregisterServerMethod(L, eventStr, callbackRef);
+			}
 
 			lua_pushboolean(L, true);
 			return 1;
 		}
 
 		int SetReconnect(lua_State* L) {
+			WebSClient& ws = client(L);
 			if (!lua_istable(L, 1)) {
-				return luaL_error(L, "Usage: SetReconnect({ enabled=bool, maxAttempts=int, initialDelay=int, maxDelay=int, multiplier=float })");
+				return luaL_error(L, "Usage: SetReconnect({ enabled=bool, maxAttempts=int, initialDelay=int, maxDelay=int, multiplier=float, jitter='none'|'full'|'decorrelated' })");
 			}
 
 			ReconnectConfig config;
@@ -250,14 +536,281 @@ namespace WebS {
 			}
 			lua_pop(L, 1);
 
-			WebSClient::instance().setReconnectConfig(config);
+			lua_getfield(L, 1, "jitter");
+			if (!lua_isnil(L, -1)) {
+				std::string jitter = lua_isstring(L, -1) ? lua_tostring(L, -1) : "";
+				if (jitter != "none" && jitter != "full" && jitter != "decorrelated") {
+					return luaL_error(L, "SetReconnect: jitter must be 'none', 'full' or 'decorrelated'");
+				}
+				config.jitter = StringToJitterMode(jitter);
+			}
+			lua_pop(L, 1);
+
+			ws.setReconnectConfig(config);
 
 			lua_pushboolean(L, true);
 			return 1;
 		}
 
 		int GetReconnectAttempts(lua_State* L) {
-			lua_pushinteger(L, WebSClient::instance().reconnectAttempts());
+			WebSClient& ws = client(L);
+			lua_pushinteger(L, ws.reconnectAttempts());
+			return 1;
+		}
+
+		static void setNumberField(lua_State* L, const char* key, double value) {
+			lua_pushnumber(L, value);
+			lua_setfield(L, -2, key);
+		}
+
+		int GetStats(lua_State* L) {
+			WebSClient& ws = client(L);
+			StatsSnapshot stats = ws.stats();
+
+			uint64_t messagesIn = 0, bytesIn = 0, messagesOut = 0, bytesOut = 0;
+			lua_newtable(L);
+
+			lua_newtable(L);
+			for (const auto& entry : stats.methods) {
+				const StatsSnapshot::Method& method = entry.second;
+				lua_newtable(L);
+				setNumberField(L, "messagesIn", static_cast<double>(method.messagesIn));
+				setNumberField(L, "bytesIn", static_cast<double>(method.bytesIn));
+				setNumberField(L, "messagesOut", static_cast<double>(method.messagesOut));
+				setNumberField(L, "bytesOut", static_cast<double>(method.bytesOut));
+				lua_setfield(L, -2, entry.first.c_str());
+
+				messagesIn += method.messagesIn;
+				bytesIn += method.bytesIn;
+				messagesOut += method.messagesOut;
+				bytesOut += method.bytesOut;
+			}
+			lua_setfield(L, -2, "methods");
+
+			lua_newtable(L);
+			for (const auto& entry : stats.queues) {
+				lua_newtable(L);
+				setNumberField(L, "current", static_cast<double>(entry.second.current));
+				setNumberField(L, "peak", static_cast<double>(entry.second.peak));
+				lua_setfield(L, -2, entry.first.c_str());
+			}
+			lua_setfield(L, -2, "queues");
+
+			setNumberField(L, "messagesIn", static_cast<double>(messagesIn));
+			setNumberField(L, "bytesIn", static_cast<double>(bytesIn));
+			setNumberField(L, "messagesOut", static_cast<double>(messagesOut));
+			setNumberField(L, "bytesOut", static_cast<double>(bytesOut));
+			setNumberField(L, "droppedMessages", static_cast<double>(stats.droppedMessages));
+			setNumberField(L, "droppedResults", static_cast<double>(stats.droppedResults));
+			setNumberField(L, "sendFailures", static_cast<double>(stats.sendFailures));
+			setNumberField(L, "connects", static_cast<double>(stats.connects));
+			setNumberField(L, "reconnects", static_cast<double>(stats.reconnects));
+			setNumberField(L, "reconnectAttempts", static_cast<double>(stats.reconnectAttempts));
+			setNumberField(L, "lastConnectMs", stats.lastConnectMs);
+			setNumberField(L, "avgConnectMs", stats.avgConnectMs);
+			setNumberField(L, "maxConnectMs", stats.maxConnectMs);
+			setNumberField(L, "invocationsInFlight", static_cast<double>(stats.invocationsInFlight));
+			setNumberField(L, "callbackErrors", static_cast<double>(stats.callbackErrors));
+			return 1;
+		}
+
+		static void pushHistogram(lua_State* L, const LatencyHistogram& histogram) {
+			lua_newtable(L);
+			setNumberField(L, "count", static_cast<double>(histogram.count()));
+			setNumberField(L, "p50", histogram.percentileMicros(50) / 1000.0);
+			setNumberField(L, "p90", histogram.percentileMicros(90) / 1000.0);
+			setNumberField(L, "p99", histogram.percentileMicros(99) / 1000.0);
+			setNumberField(L, "max", histogram.maxMicros() / 1000.0);
+		}
+
+		static void pushMethodLatency(lua_State* L, const MethodLatency& latency) {
+			lua_newtable(L);
+			pushHistogram(L, latency.send);
+			lua_setfield(L, -2, "send");
+			pushHistogram(L, latency.roundTrip);
+			lua_setfield(L, -2, "roundTrip");
+			pushHistogram(L, latency.dispatch);
+			lua_setfield(L, -2, "dispatch");
+			pushHistogram(L, latency.total);
+			lua_setfield(L, -2, "total");
+		}
+
+		int GetLatency(lua_State* L) {
+			WebSClient& ws = client(L);
+			std::map<std::string, const MethodLatency*> latencies = ws.latencies();
+
+			if (lua_isstring(L, 1)) {
+				auto it = latencies.find(lua_tostring(L, 1));
+				if (it == latencies.end()) {
+					lua_pushnil(L);
+					return 1;
+				}
+				pushMethodLatency(L, *it->second);
+				return 1;
+			}
+
+			lua_newtable(L);
+			for (const auto& entry : latencies) {
+				pushMethodLatency(L, *entry.second);
+				lua_setfield(L, -2, entry.first.c_str());
+			}
+			return 1;
+		}
+
+		int ResetLatency(lua_State* L) {
+			WebSClient& ws = client(L);
+			ws.resetLatency();
+			lua_pushboolean(L, true);
+			return 1;
+		}
+
+		int SetHandlerProfiling(lua_State* L) {
+			WebSClient& ws = client(L);
+			if (!lua_isboolean(L, 1)) {
+				return luaL_error(L, "Usage: SetHandlerProfiling(enabled, [slowThresholdMs])");
+			}
+
+			HandlerProfiler& profiler = ws.context(L)->events().profiler();
+			if (lua_isnumber(L, 2)) {
+				profiler.setSlowThresholdMs(lua_tonumber(L, 2));
+			}
+			profiler.setEnabled(lua_toboolean(L, 1) != 0);
+
+			lua_pushboolean(L, true);
+			return 1;
+		}
+
+		int GetHandlerProfile(lua_State* L) {
+			WebSClient& ws = client(L);
+			size_t limit = lua_isnumber(L, 1) ? static_cast<size_t>(lua_tointeger(L, 1)) : 10;
+			std::vector<HandlerProfileEntry> entries = ws.context(L)->events().profiler().top(limit);
+
+			lua_newtable(L);
+			for (size_t i = 0; i < entries.size(); ++i) {
+				const HandlerProfileEntry& entry = entries[i];
+				lua_newtable(L);
+				lua_pushstring(L, entry.event.c_str());
+				lua_setfield(L, -2, "event");
+				lua_pushstring(L, entry.source.c_str());
+				lua_setfield(L, -2, "source");
+				setNumberField(L, "calls", static_cast<double>(entry.calls));
+				setNumberField(L, "slowCalls", static_cast<double>(entry.slowCalls));
+				setNumberField(L, "totalMs", entry.totalMs);
+				setNumberField(L, "avgMs", entry.calls ? entry.totalMs / static_cast<double>(entry.calls) : 0.0);
+				setNumberField(L, "p50", entry.p50Ms);
+				setNumberField(L, "p90", entry.p90Ms);
+				setNumberField(L, "p99", entry.p99Ms);
+				setNumberField(L, "max", entry.maxMs);
+				lua_rawseti(L, -2, static_cast<int>(i + 1));
+			}
+			return 1;
+		}
+
+		int ResetHandlerProfile(lua_State* L) {
+			WebSClient& ws = client(L);
+			ws.context(L)->events().profiler().reset();
+			lua_pushboolean(L, true);
+			return 1;
+		}
+
+		int StartRecording(lua_State* L) {
+			WebSClient& ws = client(L);
+			if (!lua_isstring(L, 1)) {
+				return luaL_error(L, "Usage: StartRecording(path)");
+			}
+			if (!ws.startRecording(lua_tostring(L, 1))) {
+				lua_pushnil(L);
+				lua_pushstring(L, "failed to open recording file");
+				return 2;
+			}
+			lua_pushboolean(L, true);
+			return 1;
+		}
+
+		int StopRecording(lua_State* L) {
+			WebSClient& ws = client(L);
+			lua_pushnumber(L, static_cast<lua_Number>(ws.stopRecording()));
+			return 1;
+		}
+
+		int Replay(lua_State* L) {
+			WebSClient& ws = client(L);
+			if (!lua_isstring(L, 1)) {
+				return luaL_error(L, "Usage: Replay(path, [speed])");
+			}
+			double speed = luaL_optnumber(L, 2, 1.0);
+			if (speed < 0) {
+				return luaL_error(L, "Replay: speed must be 0 (max) or positive");
+			}
+
+			std::string error;
+			if (!ws.startReplay(lua_tostring(L, 1), speed, error)) {
+				lua_pushnil(L);
+				lua_pushstring(L, error.c_str());
+				return 2;
+			}
+			lua_pushboolean(L, true);
+			return 1;
+		}
+
+		int StopReplay(lua_State* L) {
+			WebSClient& ws = client(L);
+			ws.stopReplay();
+			return 0;
+		}
+
+		int ResetStats(lua_State* L) {
+			WebSClient& ws = client(L);
+			ws.resetStats();
+			lua_pushboolean(L, true);
+			return 1;
+		}
+
+		int GetEndpoints(lua_State* L) {
+			WebSClient& ws = client(L);
+			std::vector<EndpointStats> endpoints = ws.endpointStats();
+
+			lua_newtable(L);
+			for (size_t i = 0; i < endpoints.size(); ++i) {
+				const EndpointStats& entry = endpoints[i];
+				lua_newtable(L);
+				lua_pushstring(L, entry.url.c_str());
+				lua_setfield(L, -2, "url");
+				if (entry.rttMs >= 0) {
+					lua_pushnumber(L, entry.rttMs);
+					lua_setfield(L, -2, "rttMs");
+				}
+				lua_pushinteger(L, entry.consecutiveFailures);
+				lua_setfield(L, -2, "consecutiveFailures");
+				lua_pushnumber(L, static_cast<lua_Number>(entry.failures));
+				lua_setfield(L, -2, "failures");
+				lua_pushnumber(L, static_cast<lua_Number>(entry.successes));
+				lua_setfield(L, -2, "successes");
+				lua_pushboolean(L, entry.active);
+				lua_setfield(L, -2, "active");
+				lua_rawseti(L, -2, static_cast<int>(i + 1));
+			}
+			return 1;
+		}
+
+		int GetSchedulerStats(lua_State* L) {
+			WebSClient& ws = client(L);
+			SchedulerStats stats = ws.schedulerStats();
+
+			lua_newtable(L);
+			lua_pushinteger(L, stats.threads);
+			lua_setfield(L, -2, "threads");
+			lua_pushinteger(L, static_cast<lua_Integer>(stats.queued));
+			lua_setfield(L, -2, "queued");
+			lua_pushnumber(L, static_cast<lua_Number>(stats.executed));
+			lua_setfield(L, -2, "executed");
+
+			lua_newtable(L);
+			for (size_t i = 0; i < stats.threadCpuMs.size(); ++i) {
+				lua_pushnumber(L, stats.threadCpuMs[i]);
+				lua_rawseti(L, -2, static_cast<int>(i + 1));
+			}
+			lua_setfield(L, -2, "threadCpuMs");
 			return 1;
 		}
 
@@ -282,12 +835,138 @@ namespace WebS {
 			return 1;
 		}
 
+		int SetLogFormat(lua_State* L) {
+			std::string format = luaL_checkstring(L, 1);
+			if (format != "text" && format != "binary") {
+				return luaL_error(L, "Usage: SetLogFormat(format) where format is 'text' or 'binary'");
+			}
+
+			Logger::instance().setFileFormat(StringToLogFileFormat(format));
+			Logger::instance().info("Log format set to: " + format);
+			lua_pushboolean(L, true);
+			return 1;
+		}
+
+		int GetLogFormat(lua_State* L) {
+			lua_pushstring(L, LogFileFormatToString(Logger::instance().fileFormat()));
+			return 1;
+		}
+
+		int SetLogRotation(lua_State* L) {
+			if (!lua_istable(L, 1)) {
+				return luaL_error(L, "Usage: SetLogRotation({ maxSizeMb=int, keep=int, maxTotalMb=int })");
+			}
+
+			LogRotation rotation = Logger::instance().rotation();
+			lua_getfield(L, 1, "maxSizeMb");
+			if (!lua_isnil(L, -1)) {
+				rotation.maxFileBytes = static_cast<uint64_t>(std::max<lua_Integer>(0, lua_tointeger(L, -1))) << 20;
+			}
+			lua_pop(L, 1);
+
+			lua_getfield(L, 1, "keep");
+			if (!lua_isnil(L, -1)) {
+				rotation.keepFiles = static_cast<int>(lua_tointeger(L, -1));
+			}
+			lua_pop(L, 1);
+
+			lua_getfield(L, 1, "maxTotalMb");
+			if (!lua_isnil(L, -1)) {
+				rotation.maxTotalBytes = static_cast<uint64_t>(std::max<lua_Integer>(0, lua_tointeger(L, -1))) << 20;
+			}
+			lua_pop(L, 1);
+
+			Logger::instance().setRotation(rotation);
+			rotation = Logger::instance().rotation();
+			Logger::instance().info("Log rotation set: " + std::to_string(rotation.maxFileBytes >> 20) + " MB per file, " +
+				std::to_string(rotation.keepFiles) + " kept, " + std::to_string(rotation.maxTotalBytes >> 20) + " MB total");
+			lua_pushboolean(L, true);
+			return 1;
+		}
+
+		int GetRecentLogs(lua_State* L) {
+			lua_Integer limit = luaL_optinteger(L, 1, 50);
+			LogLevel minLevel = StringToLogLevel(luaL_optstring(L, 2, "verbose"));
+			std::vector<LogRecord> records = Logger::instance().recent(static_cast<size_t>(std::max<lua_Integer>(0, limit)), minLevel);
+
+			lua_createtable(L, static_cast<int>(records.size()), 0);
+			int index = 1;
+			for (const LogRecord& record : records) {
+				lua_createtable(L, 0, 4);
+				lua_pushstring(L, Logger::formatTimestamp(record).c_str());
+				lua_setfield(L, -2, "time");
+				lua_pushstring(L, LogLevelToString(record.level));
+				lua_setfield(L, -2, "level");
+				lua_pushstring(L, record.tag);
+				lua_setfield(L, -2, "source");
+				lua_pushstring(L, Logger::formatMessage(record).c_str());
+				lua_setfield(L, -2, "message");
+				lua_rawseti(L, -2, index++);
+			}
+			return 1;
+		}
+
+		int SetRecentLogLevel(lua_State* L) {
+			if (!lua_isstring(L, 1)) {
+				return luaL_error(L, "Usage: SetRecentLogLevel(level) where level is 'none', 'critical', 'error', 'warning', 'info', 'debug', or 'verbose'");
+			}
+			Logger::instance().setRecentLevel(StringToLogLevel(lua_tostring(L, 1)));
+			lua_pushboolean(L, true);
+			return 1;
+		}
+
+		int DumpRecentLogs(lua_State* L) {
+			std::string path = luaL_optstring(L, 1, Logger::instance().recentDumpPath().c_str());
+			if (path.empty()) {
+				return luaL_error(L, "Usage: DumpRecentLogs([path])");
+			}
+
+			int written = Logger::instance().dumpRecent(path);
+			if (written < 0) {
+				lua_pushnil(L);
+				lua_pushstring(L, "failed to open file");
+				return 2;
+			}
+			lua_pushinteger(L, written);
+			return 1;
+		}
+
+		int SetRecentLogDump(lua_State* L) {
+			// false or nil turns the dump on OnError off
+			if (lua_isstring(L, 1)) {
+				Logger::instance().setRecentDumpPath(lua_tostring(L, 1));
+			} else {
+				Logger::instance().setRecentDumpPath("");
+			}
+			return 0;
+		}
+
+		int SetTracing(lua_State* L) {
+			if (!lua_isboolean(L, 1)) {
+				return luaL_error(L, "Usage: SetTracing(enabled)");
+			}
+			Tracer::instance().setEnabled(lua_toboolean(L, 1) != 0);
+			return 0;
+		}
+
+		int DumpTrace(lua_State* L) {
+			const char* path = luaL_checkstring(L, 1);
+			int written = Tracer::instance().dump(path);
+			if (written < 0) {
+				lua_pushnil(L);
+				lua_pushstring(L, "failed to open trace file");
+				return 2;
+			}
+			lua_pushinteger(L, written);
+			return 1;
+		}
+
 		int GetVersion(lua_State* L) {
 			lua_pushstring(L, WebS::Version);
 			return 1;
 		}
 
-		static const struct luaL_Reg websFunctions[] = {
+		static const struct luaL_Reg clientFunctions[] = {
 			{ "Connect", Connect },
 			{ "Disconnect", Disconnect },
 			{ "SendMessage", Send },
@@ -298,17 +977,70 @@ namespace WebS {
 			{ "GetConnectionId", GetConnectionId },
 			{ "ProcessEvents", ProcessEvents },
 			{ "On", On },
+			{ "OnBatch", OnBatch },
 			{ "Off", Off },
 			{ "SetReconnect", SetReconnect },
 			{ "GetReconnectAttempts", GetReconnectAttempts },
+			{ "GetSchedulerStats", GetSchedulerStats },
+			{ "GetEndpoints", GetEndpoints },
+			{ "GetStats", GetStats },
+			{ "ResetStats", ResetStats },
+			{ "GetLatency", GetLatency },
+			{ "ResetLatency", ResetLatency },
+			{ "SetHandlerProfiling", SetHandlerProfiling },
+			{ "GetHandlerProfile", GetHandlerProfile },
+			{ "ResetHandlerProfile", ResetHandlerProfile },
+			{ "StartRecording", StartRecording },
+			{ "StopRecording", StopRecording },
+			{ "Replay", Replay },
+			{ "StopReplay", StopReplay },
+			{ NULL, NULL }
+		};
+
+		int NewClient(lua_State* L) {
+			if (!lua_isstring(L, 1)) {
+				return luaL_error(L, "Usage: NewClient(name)");
+			}
+
+			const char* name = lua_tostring(L, 1);
+			if (std::string(name) == WebSClient::DefaultClientName) {
+				return luaL_error(L, "NewClient: '%s' is reserved for the global WebS client", name);
+			}
+
+			WebSClient& ws = WebSClient::get(name);
+			ws.attach(L);
+
+			lua_newtable(L);
+			lua_pushlightuserdata(L, &ws);
+			lua_setfield(L, -2, "__client");
+			lua_pushstring(L, ws.name().c_str());
+			lua_setfield(L, -2, "name");
+			lua_pushlightuserdata(L, &ws);
+			luaL_openlib(L, NULL, clientFunctions, 1);
+			return 1;
+		}
+
+		static const struct luaL_Reg websFunctions[] = {
+			{ "NewClient", NewClient },
 			{ "SetLogLevel", SetLogLevel },
 			{ "GetLogLevel", GetLogLevel },
+			{ "SetLogFormat", SetLogFormat },
+			{ "GetLogFormat", GetLogFormat },
+			{ "SetLogRotation", SetLogRotation },
+			{ "GetRecentLogs", GetRecentLogs },
+			{ "SetRecentLogLevel", SetRecentLogLevel },
+			{ "DumpRecentLogs", DumpRecentLogs },
+			{ "SetRecentLogDump", SetRecentLogDump },
+			{ "SetTracing", SetTracing },
+			{ "DumpTrace", DumpTrace },
 			{ "GetVersion", GetVersion },
 			{ NULL, NULL }
 		};
 
 		void registerAll(lua_State* L) {
 			luaL_openlib(L, "WebS", websFunctions, 0);
+			lua_pushlightuserdata(L, &WebSClient::instance());
+			luaL_openlib(L, "WebS", clientFunctions, 1);
 		}
 
 	} // namespace LuaBindings
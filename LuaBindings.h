@@ -1,5 +1,8 @@
 #pragma once
 
+#include <vector>
+#include "Value.h"
+
 extern "C" {
 #include "lua.h"
 }
@@ -18,17 +21,48 @@ int GetConnectionId(lua_State* L);
 int ProcessEvents(lua_State* L);
 
 int On(lua_State* L);
+int OnBatch(lua_State* L);
 int Off(lua_State* L);
 
 int SetReconnect(lua_State* L);
 int GetReconnectAttempts(lua_State* L);
 
+int GetSchedulerStats(lua_State* L);
+int GetEndpoints(lua_State* L);
+int GetStats(lua_State* L);
+int ResetStats(lua_State* L);
+int GetLatency(lua_State* L);
+int ResetLatency(lua_State* L);
+int SetHandlerProfiling(lua_State* L);
+int GetHandlerProfile(lua_State* L);
+int ResetHandlerProfile(lua_State* L);
+int StartRecording(lua_State* L);
+int StopRecording(lua_State* L);
+int Replay(lua_State* L);
+int StopReplay(lua_State* L);
+
 int SetLogLevel(lua_State* L);
 int GetLogLevel(lua_State* L);
+int SetLogFormat(lua_State* L);
+int GetLogFormat(lua_State* L);
+int SetLogRotation(lua_State* L);
+int GetRecentLogs(lua_State* L);
+int SetRecentLogLevel(lua_State* L);
+int DumpRecentLogs(lua_State* L);
+int SetRecentLogDump(lua_State* L);
+
+int SetTracing(lua_State* L);
+int DumpTrace(lua_State* L);
+
+int NewClient(lua_State* L);
 
 int GetVersion(lua_State* L);
 
 void registerAll(lua_State* L);
 
+// Array part of the table at index as hub arguments; entries that are not strings,
+// numbers or booleans are skipped
+std::vector<Value> tableToArgs(lua_State* L, int index);
+
 } // namespace LuaBindings
 } // namespace WebS
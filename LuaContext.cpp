@@ -0,0 +1,241 @@
+#include "pch.h"
+#include "LuaContext.h"
+#include "WebSClient.h"
+#include "Logger.h"
+#include "Tracer.h"
+
+extern "C" {
+#include "lauxlib.h"
+}
+
+namespace WebS {
+
+LuaContext::LuaContext(lua_State* L) : L_(L) {}
+
+lua_State* LuaContext::state() const {
+    return L_;
+}
+
+EventManager& LuaContext::events() {
+    return eventManager_;
+}
+
+void LuaContext::subscribe(const std::string& methodName, int callbackRef, std::shared_ptr<const MessageFilter> filter) {
+    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+    subscriptions_[methodName][callbackRef] = std::move(filter);
+}
+
+void LuaContext::unsubscribe(const std::string& methodName, int callbackRef) {
+    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+    auto it = subscriptions_.find(methodName);
+    if (it == subscriptions_.end()) return;
+
+    it->second.erase(callbackRef);
+    if (it->second.empty()) {
+        subscriptions_.erase(it);
+    }
+}
+
+void LuaContext::collectMethods(std::set<std::string>& methods) const {
+    std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+    for (const auto& entry : subscriptions_) {
+        methods.insert(entry.first);
+    }
+}
+
+// Picks the subscriptions whose filters accept the message. Returns false when none do;
+// leaves targets empty when every subscription accepts, meaning "deliver to all".
+static bool selectSubscribers(const std::map<int, std::shared_ptr<const MessageFilter>>& subscriptions,
+                              const std::vector<Value>& args, std::vector<int>& targets) {
+    bool rejected = false;
+    for (const auto& sub : subscriptions) {
+        if (sub.second && !sub.second->matches(args)) {
+            rejected = true;
+        } else {
+            targets.push_back(sub.first);
+        }
+    }
+
+    if (targets.empty()) return false;
+    if (!rejected) targets.clear();
+    return true;
+}
+
+bool LuaContext::deliver(const std::string& methodName, const std::vector<Value>& args) {
+    std::vector<int> targets;
+    {
+        // Unsubscribed methods and filter rejections are dropped here, before anything is queued
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        auto it = subscriptions_.find(methodName);
+        if (it == subscriptions_.end()) return false;
+        if (!selectSubscribers(it->second, args, targets)) return false;
+    }
+    TraceSpan span("queue.push", "receive", methodName);
+    serverMessageQueue_.push({ methodName, args, std::move(targets) });
+    return true;
+}
+
+void LuaContext::pushAsyncResult(AsyncResult result) {
+    asyncResultsQueue_.push(std::move(result));
+}
+
+std::string LuaContext::getMessage() {
+    std::string msg;
+    if (messageQueue_.tryPop(msg)) {
+        return msg;
+    }
+    return "";
+}
+
+size_t LuaContext::queueSize() const {
+    return messageQueue_.size();
+}
+
+int LuaContext::processEvents(lua_State* L) {
+    if (!L) return 0;
+    TraceSpan span("processEvents", "dispatch");
+
+    int processed = eventManager_.processEvents(L);
+
+    std::queue<ServerMessage> serverMsgsToProcess;
+    {
+        TraceSpan popSpan("queue.pop", "dispatch");
+        std::queue<ServerMessage> temp;
+        serverMessageQueue_.swap(temp);
+        serverMsgsToProcess = std::move(temp);
+    }
+
+    for (auto& batch : batchedMessages_) {
+        batch.second.clear();
+    }
+
+    while (!serverMsgsToProcess.empty()) {
+        ServerMessage msg = std::move(serverMsgsToProcess.front());
+        serverMsgsToProcess.pop();
+
+        bool batched = eventManager_.batchCallbackCount(msg.method) > 0;
+        bool perMessage = !batched || eventManager_.callbackCount(msg.method) > 0;
+
+        if (perMessage) {
+            TraceSpan convertSpan("convert", "dispatch", msg.method);
+            std::vector<std::string> strArgs;
+            for (const auto& arg : msg.args) {
+                if (arg.is_string()) {
+                    strArgs.push_back(arg.as_string());
+                } else if (arg.is_double()) {
+                    strArgs.push_back(std::to_string(arg.as_double()));
+                } else if (arg.is_bool()) {
+                    strArgs.push_back(arg.as_bool() ? "true" : "false");
+                }
+            }
+
+            eventManager_.emit(msg.method, strArgs, msg.targets);
+        }
+
+        if (batched) {
+            batchedMessages_[msg.method].push_back(std::move(msg));
+        }
+        processed++;
+    }
+
+    processed += eventManager_.processEvents(L);
+
+    for (const auto& batch : batchedMessages_) {
+        eventManager_.dispatchBatch(L, batch.first, batch.second);
+    }
+
+    std::queue<AsyncResult> resultsToProcess;
+    {
+        std::queue<AsyncResult> temp;
+        asyncResultsQueue_.swap(temp);
+        resultsToProcess = std::move(temp);
+    }
+
+    while (!resultsToProcess.empty()) {
+        AsyncResult res = std::move(resultsToProcess.front());
+        resultsToProcess.pop();
+
+        if (res.callbackRef != LUA_NOREF && res.callbackRef != -1) {
+            if (!lua_checkstack(L, 10)) {
+                Logger::instance().error("Lua stack overflow risk in async callback");
+                luaL_unref(L, LUA_REGISTRYINDEX, res.callbackRef);
+                continue;
+            }
+
+            int top = lua_gettop(L);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, res.callbackRef);
+
+            if (lua_isfunction(L, -1)) {
+                if (res.latency) {
+                    auto now = std::chrono::steady_clock::now();
+                    res.latency->dispatch.record(now - res.completedAt);
+                    res.latency->total.record(now - res.enqueuedAt);
+                }
+                lua_pushboolean(L, res.success);
+
+                if (res.success) {
+                    pushValueToLua(L, res.result);
+                } else {
+                    lua_pushstring(L, res.error.c_str());
+                }
+
+                // The per-method name is only read by the profiler and the tracer, so it isn't
+                // built for every completion; the plain name is too long for the small-string buffer
+                static const std::string AsyncEventName = "SendMessageAsync";
+                bool named = !res.method.empty() && (eventManager_.profiler().enabled() || Tracer::instance().enabled());
+                int status = named ? eventManager_.call(L, AsyncEventName + ":" + res.method, 2) : eventManager_.call(L, AsyncEventName, 2);
+                if (status != 0) {
+                    const char* err = lua_tostring(L, -1);
+                    Logger::instance().error("Error in async callback: " + std::string(err ? err : "unknown"));
+                }
+            } else {
+                Logger::instance().error("Async callback ref is not a function!");
+            }
+
+            lua_settop(L, top);
+            luaL_unref(L, LUA_REGISTRYINDEX, res.callbackRef);
+            processed++;
+        }
+    }
+
+    return processed;
+}
+
+void LuaContext::clear() {
+    eventManager_.clear(L_);
+
+    {
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        subscriptions_.clear();
+    }
+
+    messageQueue_.clear();
+    asyncResultsQueue_.clear();
+    serverMessageQueue_.clear();
+    batchedMessages_.clear();
+}
+
+static void addDepth(StatsSnapshot& out, const char* name, size_t current, size_t peak) {
+    QueueDepth& depth = out.queues[name];
+    depth.current += current;
+    depth.peak = std::max(depth.peak, peak);
+}
+
+void LuaContext::collectStats(StatsSnapshot& out) const {
+    addDepth(out, "messages", messageQueue_.size(), messageQueue_.peak());
+    addDepth(out, "serverMessages", serverMessageQueue_.size(), serverMessageQueue_.peak());
+    addDepth(out, "asyncResults", asyncResultsQueue_.size(), asyncResultsQueue_.peak());
+
+    QueueDepth events = eventManager_.queueDepth();
+    addDepth(out, "events", events.current, events.peak);
+    out.callbackErrors += eventManager_.callbackErrors();
+}
+
+void LuaContext::resetStats() {
+    messageQueue_.resetPeak();
+    serverMessageQueue_.resetPeak();
+    asyncResultsQueue_.resetPeak();
+    eventManager_.resetStats();
+}
+
+} // namespace WebS
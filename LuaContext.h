@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include "Types.h"
+#include "ThreadSafeQueue.h"
+#include "EventManager.h"
+#include "MessageFilter.h"
+#include "ClientStats.h"
+
+extern "C" {
+#include "lua.h"
+}
+
+namespace WebS {
+
+// Everything owned by one lua_State (one MoonLoader script): its callbacks,
+// subscriptions and inbound queues. The shared connection fans inbound
+// messages out only to the contexts subscribed to the method.
+class LuaContext {
+public:
+    explicit LuaContext(lua_State* L);
+
+    lua_State* state() const;
+    EventManager& events();
+
+    void subscribe(const std::string& methodName, int callbackRef, std::shared_ptr<const MessageFilter> filter);
+    void unsubscribe(const std::string& methodName, int callbackRef);
+    void collectMethods(std::set<std::string>& methods) const;
+
+    // Called on the SignalR callback thread; returns false if the message was not queued
+    bool deliver(const std::string& methodName, const std::vector<Value>& args);
+    void pushAsyncResult(AsyncResult result);
+
+    std::string getMessage();
+    size_t queueSize() const;
+
+    int processEvents(lua_State* L);
+    void clear();
+
+    // Adds this context's queue depths and callback errors to the snapshot
+    void collectStats(StatsSnapshot& out) const;
+    void resetStats();
+
+    LuaContext(const LuaContext&) = delete;
+    LuaContext& operator=(const LuaContext&) = delete;
+
+private:
+    lua_State* L_;
+    EventManager eventManager_;
+
+    ThreadSafeQueue<std::string> messageQueue_;
+    ThreadSafeQueue<AsyncResult> asyncResultsQueue_;
+    ThreadSafeQueue<ServerMessage> serverMessageQueue_;
+
+    std::map<std::string, std::map<int, std::shared_ptr<const MessageFilter>>> subscriptions_;
+    mutable std::mutex subscriptionsMutex_;
+
+    // Scratch grouping for OnBatch delivery, game thread only; kept to reuse capacity
+    std::map<std::string, std::vector<ServerMessage>> batchedMessages_;
+};
+
+} // namespace WebS
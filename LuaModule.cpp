@@ -0,0 +1,29 @@
+#include "pch.h"
+#include "WebSClient.h"
+#include "LuaBindings.h"
+#include "Logger.h"
+#ifdef WEBS_WITH_SIGNALR
+#include "SignalRTransport.h"
+#endif
+
+extern "C" {
+#include "lua.h"
+}
+
+#ifdef _WIN32
+#define WEBS_MODULE_EXPORT __declspec(dllexport)
+#else
+#define WEBS_MODULE_EXPORT __attribute__((visibility("default")))
+#endif
+
+// require("WebS") entry point, shared by the Windows DLL and the Linux module
+extern "C" WEBS_MODULE_EXPORT int luaopen_WebS(lua_State* L) {
+#ifdef WEBS_WITH_SIGNALR
+    // Before the first client is created, since clients take their transport on construction
+    WebS::Transport::setFactory(&WebS::SignalRTransport::create);
+#endif
+    WebS::Logger::instance().info("WebS DLL Loaded and Initialized.");
+    WebS::WebSClient::instance().attach(L);
+    WebS::LuaBindings::registerAll(L);
+    return 1;
+}
@@ -0,0 +1,203 @@
+#include "pch.h"
+#include "MappedLogFile.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace WebS {
+
+MappedLogFile::~MappedLogFile() {
+    close();
+}
+
+bool MappedLogFile::isOpen() const {
+    return view_ != nullptr;
+}
+
+uint64_t MappedLogFile::size() const {
+    return written_;
+}
+
+uint64_t MappedLogFile::capacity() const {
+    return capacity_;
+}
+
+#ifdef _WIN32
+
+bool MappedLogFile::open(const std::string& path, uint64_t capacity) {
+    close();
+
+    // FILE_SHARE_READ | FILE_SHARE_WRITE so the log can be tailed while the game runs
+    file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER existing;
+    if (!GetFileSizeEx(file_, &existing) || static_cast<uint64_t>(existing.QuadPart) > capacity) {
+        close();
+        return false;
+    }
+
+    // Sizing the mapping to the capacity extends (preallocates) the file
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE,
+                                  static_cast<DWORD>(capacity >> 32), static_cast<DWORD>(capacity & 0xFFFFFFFF), nullptr);
+    if (!mapping_) {
+        close();
+        return false;
+    }
+
+    capacity_ = capacity;
+    written_ = static_cast<uint64_t>(existing.QuadPart);
+    if (!mapSegment(written_ - written_ % SegmentBytes)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedLogFile::mapSegment(uint64_t offset) {
+    unmap();
+    size_t size = static_cast<size_t>(std::min<uint64_t>(SegmentBytes, capacity_ - offset));
+    if (size == 0) return false;
+
+    void* view = MapViewOfFile(mapping_, FILE_MAP_WRITE, static_cast<DWORD>(offset >> 32),
+                               static_cast<DWORD>(offset & 0xFFFFFFFF), size);
+    if (!view) return false;
+
+    view_ = static_cast<char*>(view);
+    viewOffset_ = offset;
+    viewSize_ = size;
+    return true;
+}
+
+void MappedLogFile::unmap() {
+    if (view_) {
+        UnmapViewOfFile(view_);
+        view_ = nullptr;
+    }
+}
+
+void MappedLogFile::flush() {
+    if (view_) {
+        FlushViewOfFile(view_, 0);
+    }
+}
+
+void MappedLogFile::close() {
+    unmap();
+    if (mapping_) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+        // Drop the preallocated tail so readers only see what was written
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(written_);
+        if (SetFilePointerEx(file_, end, nullptr, FILE_BEGIN)) {
+            SetEndOfFile(file_);
+        }
+        CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+    written_ = 0;
+    capacity_ = 0;
+}
+
+#else
+
+bool MappedLogFile::open(const std::string& path, uint64_t capacity) {
+    close();
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd_, &info) != 0 || static_cast<uint64_t>(info.st_size) > capacity ||
+        ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+        close();
+        return false;
+    }
+
+    capacity_ = capacity;
+    written_ = static_cast<uint64_t>(info.st_size);
+    if (!mapSegment(written_ - written_ % SegmentBytes)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedLogFile::mapSegment(uint64_t offset) {
+    unmap();
+    size_t size = static_cast<size_t>(std::min<uint64_t>(SegmentBytes, capacity_ - offset));
+    if (size == 0) return false;
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(offset));
+    if (view == MAP_FAILED) return false;
+
+    view_ = static_cast<char*>(view);
+    viewOffset_ = offset;
+    viewSize_ = size;
+    return true;
+}
+
+void MappedLogFile::unmap() {
+    if (view_) {
+        munmap(view_, viewSize_);
+        view_ = nullptr;
+    }
+}
+
+void MappedLogFile::flush() {
+    if (view_) {
+        msync(view_, viewSize_, MS_ASYNC);
+    }
+}
+
+void MappedLogFile::close() {
+    unmap();
+    if (fd_ >= 0) {
+        // Drop the preallocated tail so readers only see what was written
+        if (ftruncate(fd_, static_cast<off_t>(written_)) != 0) {
+            // Nothing better to do: the tail stays zero-filled
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+    written_ = 0;
+    capacity_ = 0;
+}
+
+#endif
+
+bool MappedLogFile::write(const char* data, size_t size) {
+    if (!view_ || written_ + size > capacity_) {
+        return false;
+    }
+
+    while (size > 0) {
+        uint64_t viewEnd = viewOffset_ + viewSize_;
+        if (written_ >= viewEnd && !mapSegment(viewEnd)) {
+            return false;
+        }
+
+        size_t offset = static_cast<size_t>(written_ - viewOffset_);
+        size_t chunk = std::min(size, viewSize_ - offset);
+        std::memcpy(view_ + offset, data, chunk);
+        written_ += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+} // namespace WebS
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace WebS {
+
+// Append-only log file preallocated to its full capacity and written through a
+// memory-mapped window, so a write is a memcpy and a flush doesn't block on the disk.
+// close() truncates the file back to what was actually written.
+class MappedLogFile {
+public:
+    static constexpr size_t SegmentBytes = 1 << 20;   // Mapped window; multiple of the allocation granularity
+
+    MappedLogFile() = default;
+    ~MappedLogFile();
+
+    // Appends after the file's current content; capacity must be at least its size
+    bool open(const std::string& path, uint64_t capacity);
+    bool isOpen() const;
+
+    // Returns false, writing nothing, when the data doesn't fit in the remaining capacity
+    bool write(const char* data, size_t size);
+    // Asks the OS to start writing dirty pages back; the data already survives a process crash
+    void flush();
+    void close();
+
+    uint64_t size() const;
+    uint64_t capacity() const;
+
+    MappedLogFile(const MappedLogFile&) = delete;
+    MappedLogFile& operator=(const MappedLogFile&) = delete;
+
+private:
+    bool mapSegment(uint64_t offset);
+    void unmap();
+
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    char* view_ = nullptr;
+    uint64_t viewOffset_ = 0;
+    size_t viewSize_ = 0;
+    uint64_t written_ = 0;
+    uint64_t capacity_ = 0;
+};
+
+} // namespace WebS
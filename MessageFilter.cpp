@@ -0,0 +1,67 @@
+#include "pch.h"
+#include "MessageFilter.h"
+
+namespace WebS {
+
+static bool scalarEquals(const Value& a, const Value& b) {
+    if (a.type() != b.type()) return false;
+
+    switch (a.type()) {
+        case ValueType::string:
+            return a.as_string() == b.as_string();
+        case ValueType::float64:
+            return a.as_double() == b.as_double();
+        case ValueType::boolean:
+            return a.as_bool() == b.as_bool();
+        case ValueType::null:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool MessageFilter::matches(const std::vector<Value>& args) const {
+    if (argIndex < 1 || static_cast<size_t>(argIndex) > args.size()) {
+        return false;
+    }
+
+    const Value* target = &args[argIndex - 1];
+    for (const auto& key : fieldPath) {
+        if (!target->is_map()) return false;
+        const auto& map = target->as_map();
+        auto it = map.find(key);
+        if (it == map.end()) return false;
+        target = &it->second;
+    }
+
+    if (hasEquals && !scalarEquals(*target, equals)) {
+        return false;
+    }
+
+    if (hasPrefix) {
+        if (!target->is_string()) return false;
+        const std::string& str = target->as_string();
+        if (str.compare(0, prefix.size(), prefix) != 0) return false;
+    }
+
+    if (hasMin || hasMax) {
+        if (!target->is_double()) return false;
+        double num = target->as_double();
+        if (hasMin && num < min) return false;
+        if (hasMax && num > max) return false;
+    }
+
+    if (!oneOfStrings.empty() || !oneOfNumbers.empty()) {
+        if (target->is_string()) {
+            if (oneOfStrings.find(target->as_string()) == oneOfStrings.end()) return false;
+        } else if (target->is_double()) {
+            if (oneOfNumbers.find(target->as_double()) == oneOfNumbers.end()) return false;
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace WebS
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include "Value.h"
+
+namespace WebS {
+
+// Predicate attached to a server method subscription. Evaluated on the SignalR
+// callback thread, so a rejected message is never queued nor handed to Lua.
+// All predicates that are set must hold.
+struct MessageFilter {
+    int argIndex = 1;                      // 1-based, as seen from Lua
+    std::vector<std::string> fieldPath;    // empty = the argument itself, otherwise "a.b.c"
+
+    bool hasEquals = false;
+    Value equals;
+
+    bool hasPrefix = false;
+    std::string prefix;
+
+    bool hasMin = false;
+    double min = 0.0;
+    bool hasMax = false;
+    double max = 0.0;
+
+    std::set<std::string> oneOfStrings;
+    std::set<double> oneOfNumbers;
+
+    bool matches(const std::vector<Value>& args) const;
+};
+
+} // namespace WebS
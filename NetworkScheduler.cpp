@@ -0,0 +1,146 @@
+#include "pch.h"
+#include "NetworkScheduler.h"
+#include "Logger.h"
+
+namespace WebS {
+
+static int toThreadPriority(const std::string& priority) {
+    if (priority == "idle") return THREAD_PRIORITY_IDLE;
+    if (priority == "lowest") return THREAD_PRIORITY_LOWEST;
+    if (priority == "below_normal") return THREAD_PRIORITY_BELOW_NORMAL;
+    if (priority == "above_normal") return THREAD_PRIORITY_ABOVE_NORMAL;
+    return THREAD_PRIORITY_NORMAL;
+}
+
+static double fileTimeToMs(const FILETIME& ft) {
+    // FILETIME counts 100 ns ticks
+    uint64_t ticks = (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    return static_cast<double>(ticks) / 10000.0;
+}
+
+NetworkScheduler::NetworkScheduler(const SchedulerConfig& config)
+    : config_(config), state_(std::make_shared<State>()) {
+    if (config_.threads < 1) config_.threads = 1;
+
+    threads_.reserve(config_.threads);
+    for (int i = 0; i < config_.threads; ++i) {
+        threads_.emplace_back(&NetworkScheduler::workerLoop, state_, config_, static_cast<size_t>(i));
+    }
+
+    Logger::instance().debug("Network scheduler started: " + std::to_string(config_.threads) +
+        " thread(s), priority " + config_.priority);
+}
+
+NetworkScheduler::~NetworkScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stopping = true;
+    }
+    state_->cv.notify_all();
+
+    for (auto& thread : threads_) {
+        if (!thread.joinable()) continue;
+        // The last reference can be dropped from one of our own callbacks; that worker returns
+        // into workerLoop, which only touches the shared state
+        if (thread.get_id() == std::this_thread::get_id()) {
+            thread.detach();
+        } else {
+            thread.join();
+        }
+    }
+}
+
+void NetworkScheduler::schedule(const signalr::signalr_base_cb& cb, std::chrono::milliseconds delay) {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->stopping) return;
+        state_->tasks.push(Task{ std::chrono::steady_clock::now() + delay, state_->nextSequence++, cb });
+    }
+    state_->cv.notify_one();
+}
+
+void NetworkScheduler::detachWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stopping = true;
+    }
+    state_->cv.notify_all();
+
+    // Workers only touch the shared state, which they keep alive themselves
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.detach();
+        }
+    }
+}
+
+const SchedulerConfig& NetworkScheduler::config() const {
+    return config_;
+}
+
+SchedulerStats NetworkScheduler::stats() const {
+    SchedulerStats result;
+    result.threads = static_cast<int>(threads_.size());
+    result.executed = state_->executed.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        result.queued = state_->tasks.size();
+    }
+
+    for (const auto& thread : threads_) {
+        FILETIME creation, exit, kernel, user;
+        HANDLE handle = reinterpret_cast<HANDLE>(const_cast<std::thread&>(thread).native_handle());
+        if (GetThreadTimes(handle, &creation, &exit, &kernel, &user)) {
+            result.threadCpuMs.push_back(fileTimeToMs(kernel) + fileTimeToMs(user));
+        } else {
+            result.threadCpuMs.push_back(0.0);
+        }
+    }
+    return result;
+}
+
+void NetworkScheduler::workerLoop(std::shared_ptr<State> state, SchedulerConfig config, size_t index) {
+    HANDLE self = GetCurrentThread();
+    if (!SetThreadPriority(self, toThreadPriority(config.priority))) {
+        Logger::instance().warning("Failed to set network thread priority: " + std::to_string(GetLastError()));
+    }
+    if (config.affinityMask != 0 && !SetThreadAffinityMask(self, static_cast<DWORD_PTR>(config.affinityMask))) {
+        Logger::instance().warning("Failed to set network thread affinity: " + std::to_string(GetLastError()));
+    }
+    Logger::instance().verbose("Network scheduler thread " + std::to_string(index) + " running");
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (true) {
+        if (state->stopping) break;
+
+        if (state->tasks.empty()) {
+            state->cv.wait(lock);
+            continue;
+        }
+
+        auto due = state->tasks.top().due;
+        if (std::chrono::steady_clock::now() < due) {
+            state->cv.wait_until(lock, due);
+            continue;
+        }
+
+        signalr::signalr_base_cb cb = std::move(const_cast<Task&>(state->tasks.top()).cb);
+        state->tasks.pop();
+        lock.unlock();
+
+        try {
+            cb();
+        } catch (const std::exception& e) {
+            Logger::instance().error("Exception in network callback: " + std::string(e.what()));
+        } catch (...) {
+            Logger::instance().error("Unknown exception in network callback");
+        }
+        // Destroy the callback before relocking: it may hold the last scheduler reference
+        cb = nullptr;
+        state->executed.fetch_add(1, std::memory_order_relaxed);
+
+        lock.lock();
+    }
+}
+
+} // namespace WebS
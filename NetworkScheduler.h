@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include "Types.h"
+#include "signalrclient/scheduler.h"
+
+namespace WebS {
+
+// Fixed-size timer/worker pool handed to SignalR through signalr_client_config, so the
+// hub's callbacks run on a small number of low-priority threads instead of competing
+// with the game thread.
+class NetworkScheduler : public signalr::scheduler {
+public:
+    explicit NetworkScheduler(const SchedulerConfig& config);
+    ~NetworkScheduler() override;
+
+    NetworkScheduler(const NetworkScheduler&) = delete;
+    NetworkScheduler& operator=(const NetworkScheduler&) = delete;
+
+    void schedule(const signalr::signalr_base_cb& cb, std::chrono::milliseconds delay = std::chrono::milliseconds::zero()) override;
+
+    // Stops the workers without waiting for them, so the destructor no longer joins; for DLL
+    // detach, where joining under the loader lock deadlocks. Later callbacks are dropped.
+    void detachWorkers();
+
+    const SchedulerConfig& config() const;
+    SchedulerStats stats() const;
+
+private:
+    struct Task {
+        std::chrono::steady_clock::time_point due;
+        uint64_t sequence;                 // Keeps FIFO order for equal due times
+        signalr::signalr_base_cb cb;
+
+        bool operator>(const Task& other) const {
+            return due != other.due ? due > other.due : sequence > other.sequence;
+        }
+    };
+
+    // Owned jointly by the scheduler and its workers: a worker that drops the last scheduler
+    // reference from inside a callback is detached and keeps using this, never the scheduler
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::priority_queue<Task, std::vector<Task>, std::greater<Task>> tasks;
+        uint64_t nextSequence = 0;
+        bool stopping = false;
+        std::atomic<uint64_t> executed{0};
+    };
+
+    static void workerLoop(std::shared_ptr<State> state, SchedulerConfig config, size_t index);
+
+    SchedulerConfig config_;
+    std::vector<std::thread> threads_;
+    std::shared_ptr<State> state_;
+};
+
+} // namespace WebS
@@ -0,0 +1,210 @@
+#include "pch.h"
+#include "SignalRTransport.h"
+#include "signalrclient/hub_connection_builder.h"
+#include "signalrclient/signalr_client_config.h"
+#include "signalrclient/web_exception.h"
+#include "cpprest/http_client.h"
+
+namespace WebS {
+
+namespace {
+
+// Routes SignalR's own traces into the log file
+class SignalRLogWriter : public signalr::log_writer {
+public:
+    void write(const std::string& entry) override {
+        Logger::instance().write(entry);
+    }
+};
+
+signalr::trace_level toTraceLevel(LogLevel level) {
+    switch (level) {
+        case LogLevel::None: return signalr::trace_level::none;
+        case LogLevel::Critical: return signalr::trace_level::critical;
+        case LogLevel::Error: return signalr::trace_level::error;
+        case LogLevel::Warning: return signalr::trace_level::warning;
+        case LogLevel::Info: return signalr::trace_level::info;
+        case LogLevel::Debug: return signalr::trace_level::debug;
+        default: return signalr::trace_level::verbose;
+    }
+}
+
+// Maps the Connect "proxy" option onto a cpprest proxy setting
+web::web_proxy proxyFromOption(const std::string& proxy) {
+    if (proxy == "auto") return web::web_proxy(web::web_proxy::use_auto_discovery);
+    if (proxy == "none") return web::web_proxy(web::web_proxy::disabled);
+    if (proxy.empty()) return web::web_proxy();
+    return web::web_proxy(web::uri(utility::conversions::to_string_t(proxy)));
+}
+
+class SignalRConnection : public HubConnection {
+public:
+    explicit SignalRConnection(signalr::hub_connection&& connection) : connection_(std::move(connection)) {}
+
+    void on(const std::string& method, const MethodHandler& handler) override {
+        connection_.on(method, handler);
+    }
+
+    void setDisconnected(const Callback& callback) override {
+        connection_.set_disconnected(callback);
+    }
+
+    void start(Callback callback) override {
+        connection_.start(std::move(callback));
+    }
+
+    void stop(Callback callback) override {
+        connection_.stop(std::move(callback));
+    }
+
+    void invoke(const std::string& method, const std::vector<Value>& args, InvokeCallback callback) override {
+        connection_.invoke(method, args, std::move(callback));
+    }
+
+    std::string connectionId() const override {
+        return connection_.get_connection_id();
+    }
+
+    void setClientConfig(const signalr::signalr_client_config& config) {
+        connection_.set_client_config(config);
+    }
+
+private:
+    signalr::hub_connection connection_;
+};
+
+class CpprestProbe : public EndpointProbe {
+public:
+    CpprestProbe(const std::vector<std::string>& urls, const ConnectOptions& options, int timeoutMs) {
+        web::http::client::http_client_config config;
+        config.set_timeout(std::chrono::milliseconds(timeoutMs));
+        if (!options.proxy.empty()) {
+            config.set_proxy(proxyFromOption(options.proxy));
+        }
+
+        results_.resize(urls.size());
+        pplx::cancellation_token token = cancel_.get_token();
+        for (size_t i = 0; i < urls.size(); ++i) {
+            try {
+                web::http::client::http_client client(web::uri(utility::conversions::to_string_t(urls[i])), config);
+                requests_.push_back({ i, std::chrono::steady_clock::now(), client.request(web::http::methods::POST, token) });
+            } catch (const std::exception& e) {
+                results_[i].error = e.what();
+            }
+        }
+    }
+
+    std::vector<ProbeResult> wait() override {
+        for (auto& request : requests_) {
+            ProbeResult& result = results_[request.index];
+            try {
+                result.status = request.response.get().status_code();
+                result.rttMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - request.started).count();
+            } catch (const std::exception& e) {
+                if (!cancelled()) result.error = e.what();
+            }
+        }
+        requests_.clear();
+        return results_;
+    }
+
+    void cancel() override {
+        cancel_.cancel();
+    }
+
+    bool cancelled() const override {
+        return cancel_.get_token().is_canceled();
+    }
+
+private:
+    struct Request {
+        size_t index;
+        std::chrono::steady_clock::time_point started;
+        pplx::task<web::http::http_response> response;
+    };
+
+    pplx::cancellation_token_source cancel_;
+    std::vector<Request> requests_;
+    std::vector<ProbeResult> results_;
+};
+
+} // namespace
+
+std::unique_ptr<Transport> SignalRTransport::create() {
+    return std::unique_ptr<Transport>(new SignalRTransport());
+}
+
+std::shared_ptr<HubConnection> SignalRTransport::createConnection(const std::string& url, const ConnectOptions& options, LogLevel logLevel) {
+    static std::shared_ptr<SignalRLogWriter> logWriter = std::make_shared<SignalRLogWriter>();
+
+    auto connection = std::make_shared<SignalRConnection>(signalr::hub_connection_builder::create(url)
+        .with_logging(logWriter, toTraceLevel(logLevel))
+        .skip_negotiation(options.skipNegotiation)
+        .build());
+
+    signalr::signalr_client_config config;
+    if (!options.token.empty()) {
+        Logger::instance().verbose("Configuring authorization header...");
+        config.get_http_headers().emplace("Authorization", options.token);
+    }
+
+    // WPAD discovery can add seconds to every connect, so it is opt-in via proxy = "auto"
+    if (!options.proxy.empty()) {
+        config.set_proxy(proxyFromOption(options.proxy));
+    }
+
+    if (options.handshakeTimeoutMs > 0) {
+        config.set_handshake_timeout(std::chrono::milliseconds(options.handshakeTimeoutMs));
+    }
+    if (options.keepAliveMs > 0) {
+        config.set_keepalive_interval(std::chrono::milliseconds(options.keepAliveMs));
+    }
+    if (options.serverTimeoutMs > 0) {
+        config.set_server_timeout(std::chrono::milliseconds(options.serverTimeoutMs));
+    }
+    if (options.scheduler.enabled) {
+        config.set_scheduler(acquireScheduler(options.scheduler));
+    }
+    connection->setClientConfig(config);
+    return connection;
+}
+
+std::shared_ptr<EndpointProbe> SignalRTransport::probe(const std::vector<std::string>& urls, const ConnectOptions& options, int timeoutMs) {
+    return std::make_shared<CpprestProbe>(urls, options, timeoutMs);
+}
+
+int SignalRTransport::httpStatus(std::exception_ptr error) const {
+    try {
+        std::rethrow_exception(error);
+    } catch (const signalr::web_exception& e) {
+        return e.status_code();
+    } catch (...) {
+        return 0;
+    }
+}
+
+std::shared_ptr<NetworkScheduler> SignalRTransport::acquireScheduler(const SchedulerConfig& config) {
+    std::lock_guard<std::mutex> lock(schedulerMutex_);
+    if (!scheduler_ || scheduler_->config() != config) {
+        // Connections still using the old pool keep it alive until they are released
+        scheduler_ = std::make_shared<NetworkScheduler>(config);
+    }
+    return scheduler_;
+}
+
+SchedulerStats SignalRTransport::schedulerStats() const {
+    std::lock_guard<std::mutex> lock(schedulerMutex_);
+    return scheduler_ ? scheduler_->stats() : SchedulerStats();
+}
+
+void SignalRTransport::release(bool underLoaderLock) {
+    std::lock_guard<std::mutex> lock(schedulerMutex_);
+    if (scheduler_ && underLoaderLock) {
+        // DllMain: this can drop the last reference, and ~NetworkScheduler joins workers that
+        // need the loader lock we hold to exit. Detached, they wind down once DllMain returns.
+        scheduler_->detachWorkers();
+    }
+    scheduler_ = nullptr;
+}
+
+} // namespace WebS
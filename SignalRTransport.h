@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include "Transport.h"
+#include "NetworkScheduler.h"
+
+namespace WebS {
+
+// Transport over the Microsoft SignalR C++ client, with cpprest for endpoint probes.
+// Only part of builds with WEBS_WITH_SIGNALR.
+class SignalRTransport : public Transport {
+public:
+    static std::unique_ptr<Transport> create();
+
+    std::shared_ptr<HubConnection> createConnection(const std::string& url, const ConnectOptions& options, LogLevel logLevel) override;
+    std::shared_ptr<EndpointProbe> probe(const std::vector<std::string>& urls, const ConnectOptions& options, int timeoutMs) override;
+
+    int httpStatus(std::exception_ptr error) const override;
+    SchedulerStats schedulerStats() const override;
+    void release(bool underLoaderLock) override;
+
+private:
+    std::shared_ptr<NetworkScheduler> acquireScheduler(const SchedulerConfig& config);
+
+    // Shared by every connection of this client built with the same scheduler options
+    std::shared_ptr<NetworkScheduler> scheduler_;
+    mutable std::mutex schedulerMutex_;
+};
+
+} // namespace WebS
@@ -11,6 +11,7 @@ public:
     void push(T item) {
         std::lock_guard<std::mutex> lock(mutex_);
         queue_.push(std::move(item));
+        if (queue_.size() > peak_) peak_ = queue_.size();
     }
 
     bool tryPop(T& item) {
@@ -39,6 +40,17 @@ public:
         std::swap(queue_, empty);
     }
 
+    // Highest size reached since construction or the last resetPeak()
+    size_t peak() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return peak_;
+    }
+
+    void resetPeak() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        peak_ = queue_.size();
+    }
+
     // Swap contents with another queue (useful for batch processing)
     void swap(std::queue<T>& other) {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -47,6 +59,7 @@ public:
 
 private:
     std::queue<T> queue_;
+    size_t peak_ = 0;
     mutable std::mutex mutex_;
 };
 
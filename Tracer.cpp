@@ -0,0 +1,181 @@
+#include "pch.h"
+#include "Tracer.h"
+#include "Logger.h"
+#include <cstring>
+
+namespace WebS {
+
+namespace {
+
+struct TraceEvent {
+    std::atomic<uint32_t> sequence{0};   // Odd while the owner thread is writing the slot
+    const char* name = nullptr;
+    const char* category = nullptr;
+    int64_t startUs = 0;
+    int64_t durationUs = 0;
+    char detail[Tracer::MaxDetail + 1] = {};
+};
+
+struct ThreadBuffer {
+    uint32_t tid = 0;
+    std::string name;
+    std::atomic<uint64_t> written{0};
+    TraceEvent events[Tracer::RingSize];
+};
+
+// Buffers are never freed: threads are few and long-lived, and a dump may run while
+// a thread that owned one is exiting. Each is created by its thread's first span, so
+// only threads that record while tracing is enabled ever get one.
+std::mutex buffersMutex;
+std::vector<ThreadBuffer*> buffers;
+
+thread_local ThreadBuffer* currentBuffer = nullptr;
+thread_local std::string currentThreadName;   // Until the buffer exists
+
+ThreadBuffer& threadBuffer() {
+    if (!currentBuffer) {
+        currentBuffer = new ThreadBuffer();
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        currentBuffer->tid = static_cast<uint32_t>(buffers.size() + 1);
+        currentBuffer->name = std::move(currentThreadName);
+        buffers.push_back(currentBuffer);
+    }
+    return *currentBuffer;
+}
+
+void writeJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; ++c) {
+        switch (*c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            default:
+                if (static_cast<unsigned char>(*c) < 0x20) {
+                    out << ' ';
+                } else {
+                    out << *c;
+                }
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+int64_t Tracer::nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+    Logger::instance().info(std::string("Tracing ") + (enabled ? "enabled" : "disabled"));
+}
+
+void Tracer::record(const char* name, const char* category, int64_t startUs, int64_t durationUs, const char* detail) {
+    ThreadBuffer& buffer = threadBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer.events[index % RingSize];
+
+    uint32_t sequence = event.sequence.load(std::memory_order_relaxed);
+    event.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    event.name = name;
+    event.category = category;
+    event.startUs = startUs;
+    event.durationUs = durationUs;
+    if (detail) {
+        std::strncpy(event.detail, detail, MaxDetail);
+        event.detail[MaxDetail] = '\0';
+    } else {
+        event.detail[0] = '\0';
+    }
+
+    event.sequence.store(sequence + 2, std::memory_order_release);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::setThreadName(const std::string& name) {
+    if (!currentBuffer) {
+        currentThreadName = name;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    currentBuffer->name = name;
+}
+
+int Tracer::dump(const std::string& path) const {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        Logger::instance().error("Failed to open trace file: " + path);
+        return -1;
+    }
+
+    std::vector<ThreadBuffer*> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        snapshot = buffers;
+    }
+
+    int count = 0;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+
+    for (ThreadBuffer* buffer : snapshot) {
+        std::string threadName;
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            threadName = buffer->name.empty() ? "thread " + std::to_string(buffer->tid) : buffer->name;
+        }
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+        writeJsonString(out, threadName.c_str());
+        out << "}}";
+
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = written > RingSize ? written - RingSize : 0;
+        for (uint64_t i = begin; i < written; ++i) {
+            const TraceEvent& event = buffer->events[i % RingSize];
+
+            // Copy under the slot's sequence so a span being overwritten is skipped, not torn
+            uint32_t before = event.sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            const char* name = event.name;
+            const char* category = event.category;
+            int64_t startUs = event.startUs;
+            int64_t durationUs = event.durationUs;
+            char detail[MaxDetail + 1];
+            std::memcpy(detail, event.detail, sizeof(detail));
+            detail[MaxDetail] = '\0';
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event.sequence.load(std::memory_order_relaxed) != before || !name) continue;
+
+            out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"name\":";
+            writeJsonString(out, name);
+            out << ",\"cat\":";
+            writeJsonString(out, category);
+            out << ",\"ts\":" << startUs << ",\"dur\":" << durationUs;
+            if (detail[0]) {
+                out << ",\"args\":{\"detail\":";
+                writeJsonString(out, detail);
+                out << "}";
+            }
+            out << "}";
+            count++;
+        }
+    }
+
+    out << "\n]}\n";
+    Logger::instance().info("Trace written to " + path + " (" + std::to_string(count) + " spans)");
+    return count;
+}
+
+} // namespace WebS
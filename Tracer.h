@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace WebS {
+
+// Opt-in span recorder exported as Chrome trace JSON (chrome://tracing, Perfetto).
+// Each thread writes into its own fixed-size ring, so recording takes no lock; when
+// tracing is off a span costs one relaxed atomic load.
+class Tracer {
+public:
+    static constexpr size_t RingSize = 16384;     // Spans kept per thread, oldest overwritten
+    static constexpr size_t MaxDetail = 47;
+
+    static Tracer& instance();
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+
+    // name and category must be string literals; detail (e.g. a method name) is copied
+    void record(const char* name, const char* category, int64_t startUs, int64_t durationUs, const char* detail = nullptr);
+    // Cheap at any time: the name is kept until the thread's first span allocates its ring
+    void setThreadName(const std::string& name);
+
+    // Writes every buffered span; returns the number written, -1 if the file can't be opened
+    int dump(const std::string& path) const;
+
+    static int64_t nowUs();
+
+private:
+    Tracer() = default;
+    std::atomic<bool> enabled_{false};
+};
+
+// Records the enclosing scope as one span
+class TraceSpan {
+public:
+    TraceSpan(const char* name, const char* category, const char* detail = nullptr)
+        : name_(name), category_(category), detail_(detail),
+          startUs_(Tracer::instance().enabled() ? Tracer::nowUs() : -1) {}
+
+    TraceSpan(const char* name, const char* category, const std::string& detail)
+        : TraceSpan(name, category, detail.c_str()) {}
+
+    ~TraceSpan() {
+        if (startUs_ >= 0) {
+            Tracer::instance().record(name_, category_, startUs_, Tracer::nowUs() - startUs_, detail_);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    const char* detail_;    // Must outlive the span
+    int64_t startUs_;
+};
+
+} // namespace WebS
@@ -0,0 +1,390 @@
+#include "pch.h"
+#include "TrafficRecorder.h"
+#include "Logger.h"
+#include "Tracer.h"
+
+#include <cstring>
+#include <map>
+
+namespace WebS {
+
+using TrafficFormat::Tag;
+
+static void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static void putBytes(std::string& out, const void* data, size_t size) {
+    putVarint(out, size);
+    out.append(static_cast<const char*>(data), size);
+}
+
+static void putValue(std::string& out, const Value& value) {
+    switch (value.type()) {
+    case ValueType::boolean:
+        out.push_back(static_cast<char>(value.as_bool() ? Tag::True : Tag::False));
+        break;
+    case ValueType::float64: {
+        out.push_back(static_cast<char>(Tag::Float64));
+        double number = value.as_double();
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<char>(bits >> (8 * i)));
+        }
+        break;
+    }
+    case ValueType::string: {
+        out.push_back(static_cast<char>(Tag::String));
+        const std::string& text = value.as_string();
+        putBytes(out, text.data(), text.size());
+        break;
+    }
+    case ValueType::binary: {
+        out.push_back(static_cast<char>(Tag::Binary));
+        const std::vector<uint8_t>& bytes = value.as_binary();
+        putBytes(out, bytes.data(), bytes.size());
+        break;
+    }
+    case ValueType::array:
+        out.push_back(static_cast<char>(Tag::Array));
+        putVarint(out, value.as_array().size());
+        for (const auto& item : value.as_array()) {
+            putValue(out, item);
+        }
+        break;
+    case ValueType::map:
+        out.push_back(static_cast<char>(Tag::Map));
+        putVarint(out, value.as_map().size());
+        for (const auto& field : value.as_map()) {
+            putBytes(out, field.first.data(), field.first.size());
+            putValue(out, field.second);
+        }
+        break;
+    default:
+        out.push_back(static_cast<char>(Tag::Null));
+        break;
+    }
+}
+
+TrafficRecorder::~TrafficRecorder() {
+    stop();
+}
+
+bool TrafficRecorder::start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (out_.is_open()) {
+        out_.close();
+        Logger::instance().info("Traffic recording stopped: " + path_ + " (" + std::to_string(records_) + " records)");
+    }
+
+    out_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out_.is_open()) {
+        active_ = false;
+        Logger::instance().error("Failed to open recording file: " + path);
+        return false;
+    }
+    out_.write(TrafficFormat::Magic, TrafficFormat::MagicSize);
+
+    path_ = path;
+    methods_.clear();
+    records_ = 0;
+    last_ = std::chrono::steady_clock::now();
+    active_ = true;
+    Logger::instance().info("Traffic recording started: " + path);
+    return true;
+}
+
+uint64_t TrafficRecorder::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_ = false;
+    if (!out_.is_open()) return 0;
+
+    out_.close();
+    Logger::instance().info("Traffic recording stopped: " + path_ + " (" + std::to_string(records_) + " records)");
+    uint64_t written = records_;
+    records_ = 0;
+    return written;
+}
+
+void TrafficRecorder::record(const std::string& method, const std::vector<Value>& args) {
+    TraceSpan span("record", "receive", method);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!out_.is_open()) return;
+
+    // Timestamp under the lock, so deltas follow file order even with several callback threads
+    auto now = std::chrono::steady_clock::now();
+    int64_t deltaUs = std::chrono::duration_cast<std::chrono::microseconds>(now - last_).count();
+    last_ = now;
+
+    scratch_.clear();
+    putVarint(scratch_, static_cast<uint64_t>(deltaUs > 0 ? deltaUs : 0));
+
+    size_t index = 0;
+    while (index < methods_.size() && methods_[index] != method) {
+        ++index;
+    }
+    putVarint(scratch_, index);
+    if (index == methods_.size()) {
+        methods_.push_back(method);
+        putBytes(scratch_, method.data(), method.size());
+    }
+
+    putVarint(scratch_, args.size());
+    for (const auto& arg : args) {
+        putValue(scratch_, arg);
+    }
+
+    out_.write(scratch_.data(), static_cast<std::streamsize>(scratch_.size()));
+    if (!out_) {
+        active_ = false;
+        out_.close();
+        Logger::instance().error("Failed to write recording file, recording stopped: " + path_);
+        return;
+    }
+    ++records_;
+}
+
+// Bounds-checked cursor over one record; any overrun marks it failed
+struct RecordCursor {
+    const std::string& data;
+    size_t pos;
+    bool failed = false;
+
+    bool varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= data.size()) return fail();
+            uint8_t byte = static_cast<uint8_t>(data[pos++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return fail();
+    }
+
+    bool bytes(std::string& out) {
+        uint64_t size;
+        if (!varint(size)) return false;
+        if (size > data.size() - pos) return fail();
+        out.assign(data, pos, static_cast<size_t>(size));
+        pos += static_cast<size_t>(size);
+        return true;
+    }
+
+    bool value(Value& out, int depth) {
+        if (pos >= data.size() || depth > TrafficFormat::MaxDepth) return fail();
+        Tag tag = static_cast<Tag>(data[pos++]);
+        switch (tag) {
+        case Tag::Null:
+            out = Value();
+            return true;
+        case Tag::False:
+        case Tag::True:
+            out = Value(tag == Tag::True);
+            return true;
+        case Tag::Float64: {
+            if (data.size() - pos < 8) return fail();
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; ++i) {
+                bits |= static_cast<uint64_t>(static_cast<uint8_t>(data[pos++])) << (8 * i);
+            }
+            double number;
+            std::memcpy(&number, &bits, sizeof(number));
+            out = Value(number);
+            return true;
+        }
+        case Tag::String: {
+            std::string text;
+            if (!bytes(text)) return false;
+            out = Value(std::move(text));
+            return true;
+        }
+        case Tag::Binary: {
+            std::string raw;
+            if (!bytes(raw)) return false;
+            out = Value(std::vector<uint8_t>(raw.begin(), raw.end()));
+            return true;
+        }
+        case Tag::Array: {
+            uint64_t count;
+            if (!varint(count) || count > data.size() - pos) return fail();
+            std::vector<Value> items(static_cast<size_t>(count));
+            for (auto& item : items) {
+                if (!value(item, depth + 1)) return false;
+            }
+            out = Value(std::move(items));
+            return true;
+        }
+        case Tag::Map: {
+            uint64_t count;
+            if (!varint(count) || count > data.size() - pos) return fail();
+            std::map<std::string, Value> fields;
+            for (uint64_t i = 0; i < count; ++i) {
+                std::string key;
+                Value field;
+                if (!bytes(key) || !value(field, depth + 1)) return false;
+                fields.emplace(std::move(key), std::move(field));
+            }
+            out = Value(std::move(fields));
+            return true;
+        }
+        }
+        return fail();
+    }
+
+    bool fail() {
+        failed = true;
+        return false;
+    }
+};
+
+bool TrafficReader::open(const std::string& path, std::string& error) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        error = "failed to open recording file";
+        return false;
+    }
+    data_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (data_.size() < TrafficFormat::MagicSize || data_.compare(0, TrafficFormat::MagicSize, TrafficFormat::Magic, TrafficFormat::MagicSize) != 0) {
+        error = "not a WebS recording";
+        return false;
+    }
+
+    pos_ = TrafficFormat::MagicSize;
+    atUs_ = 0;
+    methods_.clear();
+    corrupt_ = false;
+    return true;
+}
+
+bool TrafficReader::next(Record& record) {
+    if (pos_ >= data_.size() || corrupt_) return false;
+
+    RecordCursor cursor{ data_, pos_ };
+    uint64_t deltaUs, index, count;
+    std::string name;
+    if (!cursor.varint(deltaUs) || !cursor.varint(index) || index > methods_.size()) {
+        corrupt_ = true;
+        return false;
+    }
+    if (index == methods_.size() && !cursor.bytes(name)) {
+        corrupt_ = true;
+        return false;
+    }
+    if (!cursor.varint(count) || count > data_.size() - cursor.pos) {
+        corrupt_ = true;
+        return false;
+    }
+
+    record.args.resize(static_cast<size_t>(count));
+    for (auto& arg : record.args) {
+        if (!cursor.value(arg, 0)) {
+            corrupt_ = true;
+            return false;
+        }
+    }
+
+    // Only a complete record moves the reader on
+    if (index == methods_.size()) {
+        methods_.push_back(std::move(name));
+    }
+    pos_ = cursor.pos;
+    atUs_ += static_cast<int64_t>(deltaUs);
+    record.atUs = atUs_;
+    record.method = &methods_[static_cast<size_t>(index)];
+    return true;
+}
+
+TrafficReplay::~TrafficReplay() {
+    stop();
+}
+
+bool TrafficReplay::start(const std::string& path, double speed, Deliver deliver, Done done, std::string& error) {
+    stop();
+
+    // Loaded on the caller's thread, so a bad path is reported right away
+    auto reader = std::make_unique<TrafficReader>();
+    if (!reader->open(path, error)) {
+        Logger::instance().error("Replay of " + path + " failed: " + error);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopRequested_ = false;
+        finished_ = false;
+    }
+    running_ = true;
+    Logger::instance().info("Replaying " + path + (speed > 0 ? " at " + std::to_string(speed) + "x" : " at max speed"));
+    thread_ = std::make_unique<std::thread>(&TrafficReplay::run, this, std::move(reader), speed, std::move(deliver), std::move(done));
+    return true;
+}
+
+void TrafficReplay::stop(std::chrono::steady_clock::time_point deadline, bool underLoaderLock) {
+    bool finished;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopRequested_ = true;
+        cv_.notify_all();
+        finished = cv_.wait_until(lock, deadline, [this] { return finished_; });
+    }
+
+    // Like the connection thread on DLL detach: join only a thread that is done, and never
+    // under the loader lock
+    if (thread_ && thread_->joinable()) {
+        if (finished && !underLoaderLock) {
+            thread_->join();
+        } else {
+            Logger::instance().warning("Replay thread did not finish in time, detaching");
+            thread_->detach();
+        }
+    }
+    thread_.reset();
+    running_ = false;
+}
+
+bool TrafficReplay::waitUntilDue(std::chrono::steady_clock::time_point due) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return !cv_.wait_until(lock, due, [this] { return stopRequested_; });
+}
+
+void TrafficReplay::run(std::unique_ptr<TrafficReader> reader, double speed, Deliver deliver, Done done) {
+    // No setThreadName: trace buffers live forever and replay threads come and go
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t delivered = 0;
+    bool stopped = false;
+    TrafficReader::Record record;
+
+    while (reader->next(record)) {
+        // At max speed the due time is always past, which leaves just the stop check
+        auto due = speed > 0 ? start + std::chrono::microseconds(static_cast<int64_t>(record.atUs / speed)) : start;
+        if (!waitUntilDue(due)) {
+            stopped = true;
+            break;
+        }
+
+        deliver(*record.method, record.args);
+        ++delivered;
+    }
+
+    if (!stopped) {
+        if (reader->corrupt()) {
+            Logger::instance().warning("Replay stopped at a truncated or corrupt record after " + std::to_string(delivered) + " records");
+        }
+        double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        Logger::instance().info("Replay finished: " + std::to_string(delivered) + " records in " + std::to_string(static_cast<int64_t>(elapsedMs)) + " ms");
+        running_ = false;
+        done(delivered);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    cv_.notify_all();
+}
+
+} // namespace WebS
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "Value.h"
+
+namespace WebS {
+
+// Recording file layout, little-endian throughout:
+//   header  "WEBSREC" + format version byte
+//   record  varint delta (us since the previous record, or since recording started)
+//           varint method index; an index one past the last seen is followed by the new
+//           method's name (varint length + bytes)
+//           varint argument count, then each argument as a tagged value
+//   value   one tag byte (TrafficTag), then: float64 8 bytes; string and binary varint length
+//           + bytes; array varint count + values; map varint count + (varint length + key, value)
+// Records are written whole, so a recording cut short by a crash replays up to its last record.
+namespace TrafficFormat {
+    constexpr char Magic[8] = { 'W', 'E', 'B', 'S', 'R', 'E', 'C', 1 };
+    constexpr size_t MagicSize = sizeof(Magic);
+    constexpr int MaxDepth = 64;   // Deepest nested array/map accepted when reading
+
+    enum class Tag : uint8_t {
+        Null = 0,
+        False = 1,
+        True = 2,
+        Float64 = 3,
+        String = 4,
+        Binary = 5,
+        Array = 6,
+        Map = 7
+    };
+}
+
+// Opt-in recorder of inbound hub invocations, written on the SignalR callback thread.
+// Each record is encoded into a reused buffer and appended to a buffered stream; when
+// recording is off a message costs one relaxed atomic load.
+class TrafficRecorder {
+public:
+    ~TrafficRecorder();
+
+    bool active() const { return active_.load(std::memory_order_relaxed); }
+
+    // Truncates path and starts a new recording; false if the file can't be opened
+    bool start(const std::string& path);
+    // Flushes and closes the file; returns the number of records written
+    uint64_t stop();
+
+    void record(const std::string& method, const std::vector<Value>& args);
+
+private:
+    std::atomic<bool> active_{false};
+    std::mutex mutex_;
+    std::ofstream out_;
+    std::string path_;
+    std::vector<std::string> methods_;   // Index = method index in the file
+    std::string scratch_;
+    std::chrono::steady_clock::time_point last_;
+    uint64_t records_ = 0;
+};
+
+// Decodes a recording loaded into memory, one record at a time
+class TrafficReader {
+public:
+    struct Record {
+        int64_t atUs = 0;          // Since the recording started
+        const std::string* method = nullptr;
+        std::vector<Value> args;
+    };
+
+    // Loads the whole file; false with error set if it is missing or not a recording
+    bool open(const std::string& path, std::string& error);
+    // False at the end of the recording or at a truncated/corrupt record
+    bool next(Record& record);
+    bool corrupt() const { return corrupt_; }
+
+private:
+    std::string data_;
+    size_t pos_ = 0;
+    int64_t atUs_ = 0;
+    std::vector<std::string> methods_;
+    bool corrupt_ = false;
+};
+
+// Feeds a recording back through a delivery callback on its own thread, at the recorded
+// pace scaled by speed (2 = twice as fast), or as fast as possible when speed is 0
+class TrafficReplay {
+public:
+    using Deliver = std::function<void(const std::string& method, const std::vector<Value>& args)>;
+    using Done = std::function<void(uint64_t delivered)>;
+
+    ~TrafficReplay();
+
+    // Stops a running replay first; false with error set if the recording can't be read
+    bool start(const std::string& path, double speed, Deliver deliver, Done done, std::string& error);
+    // Waits for the replay thread until the deadline, then detaches it (always, under the loader
+    // lock); the done callback is not called for a stopped replay
+    void stop(std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(),
+              bool underLoaderLock = false);
+    bool running() const { return running_.load(); }
+
+private:
+    void run(std::unique_ptr<TrafficReader> reader, double speed, Deliver deliver, Done done);
+    // False when stop() was requested first
+    bool waitUntilDue(std::chrono::steady_clock::time_point due);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopRequested_ = false;
+    bool finished_ = true;
+    std::atomic<bool> running_{false};
+    std::unique_ptr<std::thread> thread_;
+};
+
+} // namespace WebS
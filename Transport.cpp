@@ -0,0 +1,19 @@
+#include "pch.h"
+#include "Transport.h"
+
+namespace WebS {
+
+static std::mutex factoryMutex;
+static Transport::Factory factory;
+
+void Transport::setFactory(Factory newFactory) {
+    std::lock_guard<std::mutex> lock(factoryMutex);
+    factory = std::move(newFactory);
+}
+
+std::unique_ptr<Transport> Transport::create() {
+    std::lock_guard<std::mutex> lock(factoryMutex);
+    return factory ? factory() : nullptr;
+}
+
+} // namespace WebS
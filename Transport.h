@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <exception>
+#include "Types.h"
+#include "Value.h"
+#include "Logger.h"
+
+namespace WebS {
+
+// One hub connection as the client state machine sees it. Callbacks may run on any
+// thread; handlers and the disconnected callback are set before start().
+class HubConnection {
+public:
+    using MethodHandler = std::function<void(const std::vector<Value>&)>;
+    using Callback = std::function<void(std::exception_ptr)>;
+    using InvokeCallback = std::function<void(const Value&, std::exception_ptr)>;
+
+    virtual ~HubConnection() = default;
+
+    virtual void on(const std::string& method, const MethodHandler& handler) = 0;
+    virtual void setDisconnected(const Callback& callback) = 0;
+    virtual void start(Callback callback) = 0;
+    virtual void stop(Callback callback) = 0;
+    virtual void invoke(const std::string& method, const std::vector<Value>& args, InvokeCallback callback) = 0;
+    virtual std::string connectionId() const = 0;
+};
+
+struct ProbeResult {
+    int status = 0;        // HTTP status, 0 = no answer
+    double rttMs = 0.0;
+    std::string error;     // Why the request failed; a cancelled request has neither error nor status
+};
+
+// Requests started by Transport::probe, all in flight at once
+class EndpointProbe {
+public:
+    virtual ~EndpointProbe() = default;
+
+    // Blocks until every request has answered, failed or been cancelled; one result per url, in order
+    virtual std::vector<ProbeResult> wait() = 0;
+    virtual void cancel() = 0;
+    virtual bool cancelled() const = 0;
+};
+
+// Network side of a client: builds hub connections and probes endpoints. Each WebSClient
+// owns one, made by the factory installed with setFactory() (SignalRTransport in the DLL).
+class Transport {
+public:
+    using Factory = std::function<std::unique_ptr<Transport>()>;
+
+    static void setFactory(Factory factory);
+    // Null when no factory is installed
+    static std::unique_ptr<Transport> create();
+
+    virtual ~Transport() = default;
+
+    // logLevel is the most verbose level the connection's own traces are produced at
+    virtual std::shared_ptr<HubConnection> createConnection(const std::string& url, const ConnectOptions& options, LogLevel logLevel) = 0;
+    // POSTs to every url with the given timeout
+    virtual std::shared_ptr<EndpointProbe> probe(const std::vector<std::string>& urls, const ConnectOptions& options, int timeoutMs) = 0;
+
+    // HTTP status carried by a connection error, 0 when it has none
+    virtual int httpStatus(std::exception_ptr) const { return 0; }
+    virtual SchedulerStats schedulerStats() const { return SchedulerStats(); }
+    // Drops pooled resources at shutdown; connections still alive keep what they use. Under the
+    // loader lock (DLL detach) pooled threads must not be joined.
+    virtual void release(bool /*underLoaderLock*/) {}
+};
+
+} // namespace WebS
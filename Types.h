@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
-#include "signalrclient/signalr_value.h"
+#include <chrono>
+#include "Value.h"
 
 namespace WebS {
 
@@ -25,24 +27,121 @@ inline const char* ConnectionStatusToString(ConnectionStatus status) {
     }
 }
 
+struct QueueDepth {
+    size_t current = 0;
+    size_t peak = 0;
+};
+
+struct MethodLatency;
+
 struct AsyncResult {
     int callbackRef = -1;
-    signalr::value result;
+    Value result;
     std::string error;
     bool success = false;
+
+    std::string method;
+
+    // Stage timestamps for the method's latency histograms; null when not measured
+    MethodLatency* latency = nullptr;
+    std::chrono::steady_clock::time_point enqueuedAt;
+    std::chrono::steady_clock::time_point completedAt;
+};
+
+struct ServerMessage {
+    std::string method;
+    std::vector<Value> args;
+    std::vector<int> targets;   // callback refs accepted by filters, empty = all
 };
 
 struct LuaEvent {
     std::string name;
     std::vector<std::string> args;
+    std::vector<int> targets;   // callback refs to deliver to, empty = all
+};
+
+struct EndpointStats {
+    std::string url;
+    double rttMs = -1.0;           // < 0 = not measured yet
+    int consecutiveFailures = 0;
+    uint64_t failures = 0;
+    uint64_t successes = 0;
+    bool active = false;
+};
+
+// Dedicated SignalR callback pool; disabled = the library's default scheduling
+struct SchedulerConfig {
+    bool enabled = false;
+    int threads = 2;
+    std::string priority = "below_normal"; // idle, lowest, below_normal, normal, above_normal
+    uint64_t affinityMask = 0;             // 0 = any CPU
+
+    bool operator==(const SchedulerConfig& other) const {
+        return enabled == other.enabled && threads == other.threads &&
+            priority == other.priority && affinityMask == other.affinityMask;
+    }
+    bool operator!=(const SchedulerConfig& other) const { return !(*this == other); }
 };
 
+struct SchedulerStats {
+    int threads = 0;
+    size_t queued = 0;
+    uint64_t executed = 0;
+    std::vector<double> threadCpuMs;       // Kernel + user time per thread
+};
+
+// Per-connection settings passed to Connect; zero timeouts keep the SignalR defaults
+struct ConnectOptions {
+    std::string token;
+    bool skipNegotiation = false;  // Connect straight to the WebSocket endpoint
+    std::string transport = "websockets";
+    int connectTimeoutMs = 15000;
+    int handshakeTimeoutMs = 0;
+    int keepAliveMs = 0;
+    int serverTimeoutMs = 0;
+    std::string proxy;             // "" = system default, "auto" = WPAD, "none", or a proxy URL
+    std::vector<std::string> urls; // Endpoints to choose from; filled from the url when empty
+    bool standby = false;          // Keep a second live connection ready for failover
+    std::string standbyUrl;        // "" = best endpoint other than the active one, or the active one if there is no other
+    SchedulerConfig scheduler;
+};
+
+struct ErrorClassification {
+    bool retryable = true;
+    int statusCode = 0;            // HTTP status when the failure came from a web request
+    int retryAfterMs = 0;          // Server-suggested delay, 0 = none
+    std::string message;
+};
+
+// Randomization applied to reconnect delays so clients dropped together don't return in lockstep
+enum class JitterMode {
+    NONE = 0,           // Pure exponential
+    FULL = 1,           // Uniform in [0, exponential delay]
+    DECORRELATED = 2    // Uniform in [initial, previous delay * 3]
+};
+
+inline const char* JitterModeToString(JitterMode mode) {
+    switch (mode) {
+        case JitterMode::NONE: return "none";
+        case JitterMode::FULL: return "full";
+        case JitterMode::DECORRELATED: return "decorrelated";
+        default: return "full";
+    }
+}
+
+inline JitterMode StringToJitterMode(const std::string& str) {
+    if (str == "none") return JitterMode::NONE;
+    if (str == "decorrelated") return JitterMode::DECORRELATED;
+    return JitterMode::FULL;
+}
+
 struct ReconnectConfig {
     bool enabled = false;
     int maxAttempts = 5;           // 0 = infinite
     int initialDelayMs = 1000;     // Initial delay in ms
     int maxDelayMs = 30000;        // Maximum delay in ms
     float multiplier = 2.0f;       // Exponential backoff multiplier
+    JitterMode jitter = JitterMode::FULL;   // Plain exponential (NONE) before jitter existed
 };
 
 } // namespace WebS
@@ -0,0 +1,59 @@
+#include "pch.h"
+#include "Value.h"
+
+namespace WebS {
+
+#ifndef WEBS_WITH_SIGNALR
+
+static const char* ValueTypeToString(ValueType type) {
+    switch (type) {
+        case ValueType::map: return "map";
+        case ValueType::array: return "array";
+        case ValueType::string: return "string";
+        case ValueType::float64: return "float64";
+        case ValueType::boolean: return "boolean";
+        case ValueType::binary: return "binary";
+        default: return "null";
+    }
+}
+
+void Value::expect(ValueType type) const {
+    if (type_ != type) {
+        throw std::runtime_error(std::string("object is a '") + ValueTypeToString(type_) +
+            "' expected it to be a '" + ValueTypeToString(type) + "'");
+    }
+}
+
+double Value::as_double() const {
+    expect(ValueType::float64);
+    return double_;
+}
+
+bool Value::as_bool() const {
+    expect(ValueType::boolean);
+    return bool_;
+}
+
+const std::string& Value::as_string() const {
+    expect(ValueType::string);
+    return string_;
+}
+
+const std::vector<Value>& Value::as_array() const {
+    expect(ValueType::array);
+    return array_;
+}
+
+const std::map<std::string, Value>& Value::as_map() const {
+    expect(ValueType::map);
+    return map_;
+}
+
+const std::vector<uint8_t>& Value::as_binary() const {
+    expect(ValueType::binary);
+    return binary_;
+}
+
+#endif
+
+} // namespace WebS
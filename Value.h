@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef WEBS_WITH_SIGNALR
+#include "signalrclient/signalr_value.h"
+#endif
+
+namespace WebS {
+
+#ifdef WEBS_WITH_SIGNALR
+
+// With SignalR the hub's own value type is used as is, so arguments reach Lua without a copy
+using Value = signalr::value;
+using ValueType = signalr::value_type;
+
+#else
+
+enum class ValueType {
+    map,
+    array,
+    string,
+    float64,
+    null,
+    boolean,
+    binary
+};
+
+// Hub argument or result. Same interface as signalr::value, for builds without SignalR;
+// as_*() throws std::runtime_error when the value holds another type.
+class Value {
+public:
+    Value() = default;
+    Value(std::nullptr_t) {}
+    explicit Value(ValueType type) : type_(type) {}
+    Value(bool value) : type_(ValueType::boolean), bool_(value) {}
+    Value(double value) : type_(ValueType::float64), double_(value) {}
+    Value(const std::string& value) : type_(ValueType::string), string_(value) {}
+    Value(std::string&& value) : type_(ValueType::string), string_(std::move(value)) {}
+    Value(const char* value) : type_(ValueType::string), string_(value) {}
+    Value(const char* value, size_t length) : type_(ValueType::string), string_(value, length) {}
+    Value(const std::vector<Value>& value) : type_(ValueType::array), array_(value) {}
+    Value(std::vector<Value>&& value) : type_(ValueType::array), array_(std::move(value)) {}
+    Value(const std::map<std::string, Value>& value) : type_(ValueType::map), map_(value) {}
+    Value(std::map<std::string, Value>&& value) : type_(ValueType::map), map_(std::move(value)) {}
+    Value(const std::vector<uint8_t>& value) : type_(ValueType::binary), binary_(value) {}
+    Value(std::vector<uint8_t>&& value) : type_(ValueType::binary), binary_(std::move(value)) {}
+
+    ValueType type() const { return type_; }
+
+    bool is_map() const { return type_ == ValueType::map; }
+    bool is_array() const { return type_ == ValueType::array; }
+    bool is_string() const { return type_ == ValueType::string; }
+    bool is_double() const { return type_ == ValueType::float64; }
+    bool is_null() const { return type_ == ValueType::null; }
+    bool is_bool() const { return type_ == ValueType::boolean; }
+    bool is_binary() const { return type_ == ValueType::binary; }
+
+    double as_double() const;
+    bool as_bool() const;
+    const std::string& as_string() const;
+    const std::vector<Value>& as_array() const;
+    const std::map<std::string, Value>& as_map() const;
+    const std::vector<uint8_t>& as_binary() const;
+
+private:
+    void expect(ValueType type) const;
+
+    ValueType type_ = ValueType::null;
+    bool bool_ = false;
+    double double_ = 0.0;
+    std::string string_;
+    std::vector<Value> array_;
+    std::map<std::string, Value> map_;
+    std::vector<uint8_t> binary_;
+};
+
+#endif
+
+} // namespace WebS
@@ -1,10 +1,11 @@
 #include "pch.h"
 #include "WebSClient.h"
 #include "Logger.h"
-#include "signalrclient/hub_connection_builder.h"
-#include "signalrclient/signalr_client_config.h"
+#include "Tracer.h"
 #include <algorithm>
 #include <cmath>
+#include <queue>
+#include <cstdlib>
 
 extern "C" {
 #include "lauxlib.h"
@@ -12,11 +13,142 @@ extern "C" {
 
 namespace WebS {
 
+const char* const WebSClient::DefaultClientName = "default";
+
+
+// Stops and releases superseded connections off the connection thread, so a new session
+// never waits for the old one's stop handshake.
+class ConnectionReaper {
+public:
+    static ConnectionReaper& instance() {
+        static ConnectionReaper reaper;
+        return reaper;
+    }
+
+    // Process exit without shutdownAll(), e.g. a Lua host that never unloads the module
+    ~ConnectionReaper() {
+        finish(std::chrono::steady_clock::now() + std::chrono::milliseconds(WebSClient::ShutdownTimeoutMs), false);
+    }
+
+    void retire(std::shared_ptr<HubConnection> conn) {
+        if (!conn) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (exiting_) return;
+            pending_.push(std::move(conn));
+            if (!thread_.joinable()) {
+                thread_ = std::thread(&ConnectionReaper::run, this);
+            }
+        }
+        cv_.notify_all();
+    }
+
+    // Waits for queued teardowns until the deadline; a reaper still stuck in a stop
+    // handshake after that is detached rather than joined, and so is a finished one under
+    // the loader lock, where it can't exit before DllMain returns.
+    void finish(std::chrono::steady_clock::time_point deadline, bool underLoaderLock) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        exiting_ = true;
+        cv_.notify_all();
+        if (!thread_.joinable()) return;
+
+        bool done = cv_.wait_until(lock, deadline, [this] { return done_; });
+        lock.unlock();
+        if (done && underLoaderLock) {
+            thread_.detach();
+        } else if (done) {
+            thread_.join();
+        } else {
+            Logger::instance().warning("Connection reaper did not finish in time, detaching");
+            thread_.detach();
+        }
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return exiting_ || !pending_.empty(); });
+            if (pending_.empty()) break;
+
+            auto conn = std::move(pending_.front());
+            pending_.pop();
+            lock.unlock();
+            WebSClient::stopConnection(conn);
+            conn = nullptr;
+            lock.lock();
+        }
+        done_ = true;
+        cv_.notify_all();
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::queue<std::shared_ptr<HubConnection>> pending_;
+    std::thread thread_;
+    bool exiting_ = false;
+    bool done_ = false;
+};
+
+static std::map<std::string, std::unique_ptr<WebSClient>>& clientRegistry() {
+    // Constructed first so it is destroyed last: clients shutting down at exit retire into it
+    ConnectionReaper::instance();
+    static std::map<std::string, std::unique_ptr<WebSClient>> clients;
+    return clients;
+}
+
+static std::mutex& clientRegistryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
 WebSClient& WebSClient::instance() {
-    static WebSClient instance;
+    static WebSClient& instance = get(DefaultClientName);
     return instance;
 }
 
+WebSClient& WebSClient::get(const std::string& name) {
+    std::lock_guard<std::mutex> lock(clientRegistryMutex());
+    auto& clients = clientRegistry();
+    auto it = clients.find(name);
+    if (it == clients.end()) {
+        it = clients.emplace(name, std::unique_ptr<WebSClient>(new WebSClient(name))).first;
+        Logger::instance().debug("Created client '" + name + "'");
+    }
+    return *it->second;
+}
+
+void WebSClient::shutdownAll(bool underLoaderLock) {
+    std::vector<WebSClient*> clients;
+    {
+        std::lock_guard<std::mutex> lock(clientRegistryMutex());
+        for (const auto& entry : clientRegistry()) {
+            clients.push_back(entry.second.get());
+        }
+    }
+
+    // Signal everything first so all clients wind down in parallel under one deadline
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ShutdownTimeoutMs);
+    for (WebSClient* client : clients) {
+        client->beginShutdown();
+    }
+    for (WebSClient* client : clients) {
+        client->finishShutdown(deadline, underLoaderLock);
+    }
+    ConnectionReaper::instance().finish(deadline, underLoaderLock);
+}
+
+WebSClient::WebSClient(const std::string& name)
+    : name_(name), contextRegistryKey_("WebS.Context." + name), transport_(Transport::create()) {}
+
+const std::string& WebSClient::name() const {
+    return name_;
+}
+
+std::string WebSClient::logTag() const {
+    return name_ == DefaultClientName ? "" : "[" + name_ + "] ";
+}
+
 WebSClient::~WebSClient() {
     shutdown();
 }
@@ -29,16 +161,95 @@ ConnectionStatus WebSClient::status() const {
     return status_.load();
 }
 
-void WebSClient::setLuaState(lua_State* L) {
-    luaState_ = L;
+struct ContextSentinel {
+    WebSClient* client;
+    lua_State* L;
+};
+
+static int contextGc(lua_State* L) {
+    ContextSentinel* sentinel = static_cast<ContextSentinel*>(lua_touserdata(L, 1));
+    if (sentinel && sentinel->client) {
+        sentinel->client->detach(sentinel->L);
+    }
+    return 0;
+}
+
+std::shared_ptr<LuaContext> WebSClient::attach(lua_State* L) {
+    std::shared_ptr<LuaContext> ctx;
+    {
+        std::lock_guard<std::mutex> lock(contextsMutex_);
+        auto it = contexts_.find(L);
+        if (it != contexts_.end()) return it->second;
+        ctx = std::make_shared<LuaContext>(L);
+        ctx->events().setLegacyCallbacks(name_ == DefaultClientName);
+        contexts_[L] = ctx;
+    }
+
+    // The registry is shared by the state and all of its coroutines, so they resolve to the
+    // same context. The sentinel's __gc drops the context when the script's state is closed.
+    ContextSentinel* sentinel = static_cast<ContextSentinel*>(lua_newuserdata(L, sizeof(ContextSentinel)));
+    sentinel->client = this;
+    sentinel->L = L;
+    lua_newtable(L);
+    lua_pushcfunction(L, contextGc);
+    lua_setfield(L, -2, "__gc");
+    lua_setmetatable(L, -2);
+    lua_setfield(L, LUA_REGISTRYINDEX, contextRegistryKey_.c_str());
+
+    Logger::instance().debug(logTag() + "Lua context attached (" + std::to_string(contextCount()) + " active)");
+    return ctx;
+}
+
+void WebSClient::detach(lua_State* L) {
+    {
+        std::lock_guard<std::mutex> lock(contextsMutex_);
+        auto it = contexts_.find(L);
+        if (it != contexts_.end()) {
+            ClientStats::add(stats_.detachedCallbackErrors, it->second->events().callbackErrors());
+            contexts_.erase(it);
+        }
+    }
+    Logger::instance().debug(logTag() + "Lua context detached (" + std::to_string(contextCount()) + " active)");
+}
+
+std::shared_ptr<LuaContext> WebSClient::context(lua_State* L) {
+    lua_getfield(L, LUA_REGISTRYINDEX, contextRegistryKey_.c_str());
+    ContextSentinel* sentinel = static_cast<ContextSentinel*>(lua_touserdata(L, -1));
+    lua_State* mainState = sentinel ? sentinel->L : nullptr;
+    lua_pop(L, 1);
+
+    if (mainState) {
+        std::lock_guard<std::mutex> lock(contextsMutex_);
+        auto it = contexts_.find(mainState);
+        if (it != contexts_.end()) return it->second;
+    }
+    return attach(L);
 }
 
-lua_State* WebSClient::luaState() const {
-    return luaState_;
+size_t WebSClient::contextCount() const {
+    std::lock_guard<std::mutex> lock(contextsMutex_);
+    return contexts_.size();
 }
 
-EventManager& WebSClient::events() {
-    return eventManager_;
+void WebSClient::emit(const std::string& eventName, const std::vector<std::string>& args) {
+    if (eventName == "OnError") {
+        // Keeps the context leading up to the failure even when file logging is quiet
+        Logger::instance().dumpRecentOnError();
+    }
+
+    std::lock_guard<std::mutex> lock(contextsMutex_);
+    for (const auto& entry : contexts_) {
+        entry.second->events().emit(eventName, args);
+    }
+}
+
+std::set<std::string> WebSClient::subscribedMethods() const {
+    std::set<std::string> methods;
+    std::lock_guard<std::mutex> lock(contextsMutex_);
+    for (const auto& entry : contexts_) {
+        entry.second->collectMethods(methods);
+    }
+    return methods;
 }
 
 void WebSClient::setReconnectConfig(const ReconnectConfig& config) {
@@ -57,33 +268,148 @@ int WebSClient::reconnectAttempts() const {
 
 int WebSClient::calculateBackoffDelay(int attempt) {
     std::lock_guard<std::mutex> lock(reconnectMutex_);
+    const ReconnectConfig& config = reconnectConfig_;
     if (attempt < 0) attempt = 0;
     if (attempt > 20) attempt = 20;
-    double delay = reconnectConfig_.initialDelayMs * std::pow(reconnectConfig_.multiplier, attempt);
-    if (delay > static_cast<double>(reconnectConfig_.maxDelayMs) || delay < 0) {
-        return reconnectConfig_.maxDelayMs;
+
+    double cap = static_cast<double>(config.maxDelayMs);
+    double delay;
+    switch (config.jitter) {
+        case JitterMode::DECORRELATED: {
+            double base = static_cast<double>(config.initialDelayMs);
+            double previous = attempt == 0 || previousDelayMs_ <= 0 ? base : previousDelayMs_;
+            double upper = std::max(base, std::min(cap, previous * 3.0));
+            delay = std::uniform_real_distribution<double>(base, upper)(random_);
+            break;
+        }
+        case JitterMode::FULL: {
+            double ceiling = std::min(cap, config.initialDelayMs * std::pow(config.multiplier, attempt));
+            delay = std::uniform_real_distribution<double>(0.0, std::max(0.0, ceiling))(random_);
+            break;
+        }
+        default:
+            delay = config.initialDelayMs * std::pow(config.multiplier, attempt);
+            break;
+    }
+
+    if (delay > cap || delay < 0) {
+        delay = cap;
     }
+    previousDelayMs_ = delay;
     return static_cast<int>(delay);
 }
 
-bool WebSClient::connect(const std::string& url, const std::string& token) {
-    Logger::instance().debug("Connect called with URL: " + url);
-    Logger::instance().verbose("Token provided: " + std::string(token.empty() ? "no" : "yes (length: " + std::to_string(token.length()) + ")"));
+// Sorts connection failures into ones worth retrying and ones that will fail the same way
+// again, and picks up a server-suggested delay ("Retry-After: <seconds>") from the message.
+ErrorClassification WebSClient::classifyError(std::exception_ptr error) const {
+    ErrorClassification result;
+    if (!error) return result;
 
-    std::string tempUrl = url;
+    std::string message;
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        message = e.what();
+    } catch (...) {
+        return result;
+    }
 
-    size_t schemePos = tempUrl.find("://");
+    result.statusCode = transport_ ? transport_->httpStatus(error) : 0;
+    switch (result.statusCode) {
+        case 400: // Bad request
+        case 401: // Unauthorized
+        case 403: // Forbidden
+        case 404: // Hub not found
+        case 405:
+            result.retryable = false;
+            break;
+        default:
+            break;
+    }
+    result.message = message;
+
+    std::string lower = message;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    size_t hintPos = lower.find("retry-after");
+    if (hintPos != std::string::npos) {
+        size_t digits = lower.find_first_of("0123456789", hintPos);
+        if (digits != std::string::npos && digits - hintPos <= 14) {
+            int seconds = std::atoi(lower.c_str() + digits);
+            result.retryAfterMs = std::min(seconds, MaxRetryAfterSeconds) * 1000;
+        }
+    }
+    return result;
+}
+
+static bool normalizeUrl(std::string& url) {
+    size_t schemePos = url.find("://");
     if (schemePos == std::string::npos) {
-        tempUrl = "https://" + tempUrl;
+        url = "https://" + url;
         Logger::instance().verbose("No scheme provided, defaulting to https://");
-    } else {
-        std::string scheme = tempUrl.substr(0, schemePos);
-        std::transform(scheme.begin(), scheme.end(), scheme.begin(), ::tolower);
-        if (scheme != "http" && scheme != "https") {
-            Logger::instance().error("Invalid URL scheme: '" + scheme + "'");
+        return true;
+    }
+
+    std::string scheme = url.substr(0, schemePos);
+    std::transform(scheme.begin(), scheme.end(), scheme.begin(), ::tolower);
+    if (scheme != "http" && scheme != "https") {
+        Logger::instance().error("Invalid URL scheme: '" + scheme + "'");
+        return false;
+    }
+    Logger::instance().verbose("URL scheme: " + scheme);
+    return true;
+}
+
+bool WebSClient::connect(const std::string& url, const ConnectOptions& options) {
+    Logger::instance().debug("Connect called with URL: " + (url.empty() ? std::to_string(options.urls.size()) + " endpoint(s)" : url));
+    Logger::instance().verbose("Token provided: " + std::string(options.token.empty() ? "no" : "yes (length: " + std::to_string(options.token.length()) + ")"));
+
+    ConnectOptions request = options;
+    if (!url.empty()) {
+        request.urls.insert(request.urls.begin(), url);
+    }
+    if (request.urls.empty()) {
+        Logger::instance().error("Connect requires a url");
+        return false;
+    }
+    for (auto& endpoint : request.urls) {
+        if (!normalizeUrl(endpoint)) return false;
+    }
+    if (!request.standbyUrl.empty() && !normalizeUrl(request.standbyUrl)) {
+        return false;
+    }
+
+    if (!transport_) {
+        Logger::instance().error("No transport available in this build");
+        return false;
+    }
+
+    std::string transport = options.transport;
+    std::transform(transport.begin(), transport.end(), transport.begin(), ::tolower);
+    if (transport != "websockets") {
+        // The SignalR C++ client only implements the WebSockets transport
+        Logger::instance().error("Unsupported transport: '" + options.transport + "'");
+        return false;
+    }
+
+    if (options.connectTimeoutMs <= 0 || options.handshakeTimeoutMs < 0 || options.keepAliveMs < 0 || options.serverTimeoutMs < 0) {
+        Logger::instance().error("Invalid connect options: timeouts must not be negative and connectTimeoutMs must be positive");
+        return false;
+    }
+    if (options.scheduler.enabled) {
+        const std::string& priority = options.scheduler.priority;
+        if (options.scheduler.threads < 1 || options.scheduler.threads > MaxSchedulerThreads) {
+            Logger::instance().error("Invalid connect options: scheduler threads must be between 1 and " + std::to_string(MaxSchedulerThreads));
             return false;
         }
-        Logger::instance().verbose("URL scheme: " + scheme);
+        if (priority != "idle" && priority != "lowest" && priority != "below_normal" &&
+            priority != "normal" && priority != "above_normal") {
+            Logger::instance().error("Invalid connect options: unknown scheduler priority '" + priority + "'");
+            return false;
+        }
+    }
+    if (options.keepAliveMs > 0 && options.serverTimeoutMs > 0 && options.serverTimeoutMs <= options.keepAliveMs) {
+        Logger::instance().error("Invalid connect options: serverTimeoutMs must be greater than keepAliveMs");
+        return false;
     }
 
     ConnectionStatus currentStatus = status_.load();
@@ -94,331 +420,718 @@ bool WebSClient::connect(const std::string& url, const std::string& token) {
         return false;
     }
 
-    if (currentStatus != ConnectionStatus::DISCONNECTED) {
-        Logger::instance().info("Stopping current connection attempt...");
-        stopThread_ = true;
+    if (shutdown_.load()) {
+        Logger::instance().error("Connect called after shutdown");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(connectionMutex_);
+        currentOptions_ = request;
     }
 
-    if (connectionThread_) {
-        Logger::instance().verbose("Waiting for previous connection thread to finish...");
-        if (connectionThread_->joinable()) {
-            connectionThread_->join();
+    // Hand the request to the connection thread; a running attempt is interrupted there and
+    // its connection is torn down in the background, so this never blocks the game thread.
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        if (currentStatus != ConnectionStatus::DISCONNECTED) {
+            Logger::instance().info("Stopping current connection attempt...");
+            stopThread_ = true;
         }
-        connectionThread_.reset();
-        Logger::instance().verbose("Previous connection thread finished");
+        // Cancels the running attempt's probe; the new session can't start its own until the
+        // request is posted, so it never gets cancelled here
+        endpoints_.cancelProbes();
+        pendingOptions_ = std::move(request);
+        connectRequested_ = true;
+        // Before the thread can take the request: an idle one may reach CONNECTED right away
+        setStatus(ConnectionStatus::CONNECTING);
     }
+    stateCv_.notify_all();
 
+    if (!connectionThread_) {
+        Logger::instance().debug("Starting connection thread...");
+        try {
+            connectionThread_ = std::make_unique<std::thread>(&WebSClient::connectionThreadFunc, this);
+            Logger::instance().verbose("Connection thread started successfully");
+        } catch (const std::exception& e) {
+            Logger::instance().error("Failed to start connection thread: " + std::string(e.what()));
+            {
+                std::lock_guard<std::mutex> lock(stateMutex_);
+                connectRequested_ = false;
+            }
+            setStatus(ConnectionStatus::DISCONNECTED);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void WebSClient::registerServerMethod(lua_State* L, const std::string& methodName, int callbackRef, std::shared_ptr<const MessageFilter> filter) {
+    Logger::instance().debug("Registering server method: " + methodName + (filter ? " (filtered)" : ""));
+    context(L)->subscribe(methodName, callbackRef, std::move(filter));
+
+    bool unbound;
     {
-        std::lock_guard<std::mutex> lock(connectionMutex_);
-        connection_ = nullptr;
-        currentUrl_ = tempUrl;
-        currentToken_ = token;
+        std::lock_guard<std::mutex> lock(serverMethodsMutex_);
+        unbound = status_.load() == ConnectionStatus::CONNECTED && boundServerMethods_.find(methodName) == boundServerMethods_.end();
     }
 
-    setStatus(ConnectionStatus::DISCONNECTED);
-    stopThread_ = false;
-    destroyed_ = false;
-    reconnectAttempts_ = 0;
-    reconnecting_ = false;
+    if (unbound) {
+        Logger::instance().verbose("Server method '" + methodName + "' is not bound on the live connection, refreshing handlers");
+        requestRefresh();
+    }
+}
 
-    Logger::instance().debug("Starting connection thread...");
-    try {
-        connectionThread_ = std::make_unique<std::thread>(&WebSClient::connectionThreadFunc, this, tempUrl, token);
-        Logger::instance().verbose("Connection thread started successfully");
-    } catch (const std::exception& e) {
-        Logger::instance().error("Failed to start connection thread: " + std::string(e.what()));
-        return false;
+void WebSClient::requestRefresh() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        refreshRequested_ = true;
     }
+    stateCv_.notify_all();
+}
 
-    return true;
+// Only a more verbose level needs a rebuild: what a connection traces beyond a quieter level is
+// filtered out in Logger::write, which is far cheaper than swapping connections
+void WebSClient::unregisterServerMethod(lua_State* L, const std::string& methodName, int callbackRef) {
+    context(L)->unsubscribe(methodName, callbackRef);
 }
 
-void WebSClient::registerServerMethod(const std::string& methodName) {
-    Logger::instance().debug("Registering server method: " + methodName);
-    std::lock_guard<std::mutex> lock(serverMethodsMutex_);
-    registeredServerMethods_.insert(methodName);
+std::set<std::string> WebSClient::registerAllServerMethods(HubConnection& conn, uint64_t generation) {
+    std::set<std::string> methods = subscribedMethods();
+    Logger::instance().logf(LogLevel::Verbose, LogFormat::RegisteringMethods, methods.size());
+
+    for (const auto& methodName : methods) {
+        Logger::instance().logf(LogLevel::Verbose, LogFormat::RegisteringHandler, methodName);
+        MethodCounters* counters = &stats_.method(methodName);
+        conn.on(methodName, [this, methodName, generation, counters](const std::vector<Value>& args) {
+            if (destroyed_.load() || generation != connectionGeneration_.load()) return;
+            TraceSpan span("hub.receive", "receive", methodName);
+
+            if (recorder_.active()) {
+                recorder_.record(methodName, args);
+            }
+            dispatchServerMessage(methodName, args, *counters);
+        });
+    }
+    return methods;
 }
 
-void WebSClient::unregisterServerMethod(const std::string& methodName) {
-    Logger::instance().debug("Unregistering server method: " + methodName);
-    std::lock_guard<std::mutex> lock(serverMethodsMutex_);
-    registeredServerMethods_.erase(methodName);
+void WebSClient::dispatchServerMessage(const std::string& methodName, const std::vector<Value>& args, MethodCounters& counters) {
+    ClientStats::add(counters.messagesIn);
+    ClientStats::add(counters.bytesIn, ClientStats::payloadBytes(args));
+
+    // Fan out only to the scripts subscribed to this method
+    bool delivered = false;
+    {
+        std::lock_guard<std::mutex> lock(contextsMutex_);
+        for (const auto& entry : contexts_) {
+            delivered = entry.second->deliver(methodName, args) || delivered;
+        }
+    }
+    if (delivered) {
+        Logger::instance().logf(LogLevel::Verbose, LogFormat::ReceivedServerMethod, methodName, args.size());
+    } else {
+        ClientStats::add(stats_.droppedMessages);
+    }
+}
+
+bool WebSClient::startRecording(const std::string& path) {
+    return recorder_.start(path);
 }
 
-void WebSClient::registerAllServerMethods(signalr::hub_connection& conn) {
+uint64_t WebSClient::stopRecording() {
+    return recorder_.stop();
+}
+
+bool WebSClient::startReplay(const std::string& path, double speed, std::string& error) {
+    if (shutdown_.load()) {
+        error = "client is shut down";
+        return false;
+    }
+
+    // Replayed messages take the live path from fan-out on, connected or not, but are never
+    // recorded again
+    return replay_.start(path, speed,
+        [this](const std::string& methodName, const std::vector<Value>& args) {
+            TraceSpan span("replay.receive", "receive", methodName);
+            dispatchServerMessage(methodName, args, stats_.method(methodName));
+        },
+        [this](uint64_t delivered) {
+            emit("OnReplayDone", { std::to_string(delivered) });
+        },
+        error);
+}
+
+void WebSClient::stopReplay() {
+    replay_.stop();
+}
+
+bool WebSClient::hasUnboundServerMethods() const {
+    std::set<std::string> methods = subscribedMethods();
     std::lock_guard<std::mutex> lock(serverMethodsMutex_);
-    Logger::instance().verbose("Registering " + std::to_string(registeredServerMethods_.size()) + " server methods on connection");
-    for (const auto& methodName : registeredServerMethods_) {
-        Logger::instance().verbose("  - Registering handler for: " + methodName);
-        conn.on(methodName, [this, methodName](const std::vector<signalr::value>& args) {
-            if (destroyed_.load()) return;
-            Logger::instance().verbose("Received server method call: " + methodName + " with " + std::to_string(args.size()) + " args");
-            serverMessageQueue_.push({ methodName, args });
-        });
+    for (const auto& methodName : methods) {
+        if (boundServerMethods_.find(methodName) == boundServerMethods_.end()) {
+            return true;
+        }
     }
+    return false;
 }
 
-void WebSClient::connectionThreadFunc(std::string urlStr, std::string tokenStr) {
-    Logger::instance().debug("Connection thread started");
-    Logger::instance().verbose("Thread ID: " + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())));
+std::shared_ptr<HubConnection> WebSClient::buildConnection(const std::string& url, const ConnectOptions& options, uint64_t generation, std::set<std::string>& boundMethods) {
+    Logger::instance().verbose("Building hub connection...");
+    std::shared_ptr<HubConnection> newConnection = transport_->createConnection(url, options, Logger::instance().minLevel());
+    Logger::instance().verbose("Hub connection built");
 
-    std::shared_ptr<signalr::hub_connection> threadConnection = nullptr;
+    Logger::instance().verbose("Setting disconnected handler...");
+    newConnection->setDisconnected([this, generation](std::exception_ptr ex) {
+        handleDisconnected(generation, ex);
+    });
 
-    try {
-        setStatus(ConnectionStatus::CONNECTING);
-        Logger::instance().info("Connecting to: " + urlStr);
+    boundMethods = registerAllServerMethods(*newConnection, generation);
+    return newConnection;
+}
 
-        Logger::instance().verbose("Building hub connection...");
-        auto newConnection = signalr::hub_connection_builder::create(urlStr)
-            .with_logging(Logger::getShared(), signalr::trace_level::verbose)
-            .build();
-        Logger::instance().verbose("Hub connection built");
+SchedulerStats WebSClient::schedulerStats() const {
+    return transport_ ? transport_->schedulerStats() : SchedulerStats();
+}
+
+bool WebSClient::stateEventPending() const {
+    return !droppedConnections_.empty() || refreshRequested_;
+}
 
-        if (!tokenStr.empty()) {
-            Logger::instance().verbose("Configuring authorization header...");
-            signalr::signalr_client_config config;
-            config.get_http_headers().emplace("Authorization", tokenStr);
-            config.set_proxy({ web::web_proxy::use_auto_discovery });
-            newConnection.set_client_config(config);
+bool WebSClient::startConnection(HubConnection& conn, int timeoutMs, bool abandonOnEvents) {
+    // Shared with the start callback, which may fire after a timeout has already returned
+    struct StartState {
+        bool done = false;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<StartState>();
+
+    Logger::instance().debug("Starting connection...");
+    TraceSpan span("connect.start", "connect");
+    auto start_time = std::chrono::steady_clock::now();
+    conn.start([this, state](std::exception_ptr exception) {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            state->done = true;
+            state->error = exception;
         }
+        stateCv_.notify_all();
+    });
 
-        Logger::instance().verbose("Setting disconnected handler...");
-        newConnection.set_disconnected([this](std::exception_ptr ex) {
-            handleDisconnected(ex);
-        });
+    Logger::instance().verbose("Waiting for connection to establish (timeout: " + std::to_string(timeoutMs) + "ms)...");
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    bool finished = stateCv_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, &state, abandonOnEvents] {
+        return state->done || stopThread_.load() || (abandonOnEvents && stateEventPending());
+    });
+
+    if (stopThread_.load()) {
+        return false;
+    }
+    if (!state->done && abandonOnEvents && stateEventPending()) {
+        Logger::instance().debug("Connection start abandoned for a pending drop or refresh");
+        return false;
+    }
+    if (!finished) {
+        throw std::runtime_error("Connection timeout");
+    }
+    if (state->error) {
+        // Keep the original type so callers can classify it (e.g. web_exception status codes)
+        std::rethrow_exception(state->error);
+    }
 
-        registerAllServerMethods(newConnection);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    Logger::instance().verbose("Connection established in " + std::to_string(elapsed) + "ms");
+    return true;
+}
 
-        std::atomic<bool> connection_started{ false };
-        std::atomic<bool> connection_failed{ false };
+void WebSClient::stopConnection(const std::shared_ptr<HubConnection>& conn) {
+    if (!conn) return;
+    TraceSpan span("connection.stop", "connect");
 
-        Logger::instance().debug("Starting connection...");
-        newConnection.start([&connection_started, &connection_failed](std::exception_ptr exception) {
-            if (exception) {
-                connection_failed = true;
-            } else {
-                connection_started = true;
-            }
-        });
+    auto stopPromise = std::make_shared<std::promise<void>>();
+    auto stopFuture = stopPromise->get_future();
+
+    conn->stop([stopPromise](std::exception_ptr) {
+        stopPromise->set_value();
+    });
 
-        Logger::instance().verbose("Waiting for connection to establish (timeout: 15s)...");
-        auto start_time = std::chrono::steady_clock::now();
-        while (!connection_started.load() && !connection_failed.load()) {
-            if (std::chrono::steady_clock::now() - start_time > std::chrono::seconds(15)) {
-                throw std::runtime_error("Connection timeout");
+    if (stopFuture.wait_for(std::chrono::seconds(5)) == std::future_status::timeout) {
+        Logger::instance().error("Connection stop timed out");
+    }
+}
+
+void WebSClient::retireConnection(std::shared_ptr<HubConnection> conn) {
+    ConnectionReaper::instance().retire(std::move(conn));
+}
+
+std::shared_ptr<HubConnection> WebSClient::takeConnection() {
+    std::lock_guard<std::mutex> lock(connectionMutex_);
+    return std::move(connection_);
+}
+
+bool WebSClient::waitWhileConnected(const ConnectOptions& options, std::exception_ptr& error) {
+    auto nextStandbyAttempt = std::chrono::steady_clock::now();
+
+    auto woken = [this] {
+        return stopThread_.load() || stateEventPending();
+    };
+
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    while (true) {
+        // Drops and refreshes go first; a standby being prepared is abandoned for them
+        bool wantStandby = options.standby && !hasStandby();
+        if (wantStandby && std::chrono::steady_clock::now() >= nextStandbyAttempt && !woken()) {
+            lock.unlock();
+            if (!prepareStandby(standbyEndpoint(options), options)) {
+                nextStandbyAttempt = std::chrono::steady_clock::now() + std::chrono::milliseconds(StandbyRetryMs);
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            lock.lock();
+            continue;
         }
 
-        if (connection_failed.load()) {
-            throw std::runtime_error("Failed to start connection");
+        if (wantStandby) {
+            stateCv_.wait_until(lock, nextStandbyAttempt, woken);
+        } else {
+            stateCv_.wait(lock, woken);
         }
 
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now() - start_time).count();
-        Logger::instance().verbose("Connection established in " + std::to_string(elapsed) + "ms");
-
-        {
-            std::lock_guard<std::mutex> lock(connectionMutex_);
-            threadConnection = std::make_shared<signalr::hub_connection>(std::move(newConnection));
-            connection_ = threadConnection;
-            destroyed_ = false;
+        if (stopThread_.load()) {
+            return false;
         }
 
-        setStatus(ConnectionStatus::CONNECTED);
-        reconnectAttempts_ = 0;
-        reconnecting_ = false;
-        Logger::instance().success("Connected successfully to hub.");
-        eventManager_.emit("OnConnect");
+        if (!droppedConnections_.empty()) {
+            std::vector<DroppedConnection> dropped;
+            dropped.swap(droppedConnections_);
+            lock.unlock();
+
+            bool activeDropped = false;
+            std::exception_ptr activeError;
+            for (const auto& entry : dropped) {
+                if (entry.generation == connectionGeneration_.load()) {
+                    activeDropped = true;
+                    activeError = entry.error;
+                    endpoints_.reportFailure(activeUrl());
+                } else if (entry.generation == standbyGeneration_) {
+                    // Drops of connections already replaced or retired are stale
+                    Logger::instance().warning(logTag() + "Standby connection lost");
+                    retireConnection(takeStandby());
+                    nextStandbyAttempt = std::chrono::steady_clock::now() + std::chrono::milliseconds(StandbyRetryMs);
+                }
+            }
 
-        Logger::instance().verbose("Entering connection maintenance loop...");
-        while (!stopThread_.load() && status_.load() == ConnectionStatus::CONNECTED) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (activeDropped && !promoteStandby()) {
+                error = activeError;
+                return true;
+            }
+            lock.lock();
+            continue;
         }
-        Logger::instance().verbose("Exited connection maintenance loop (stopThread=" +
-            std::string(stopThread_.load() ? "true" : "false") + ", status=" +
-            ConnectionStatusToString(status_.load()) + ")");
-    }
-    catch (const std::exception& e) {
-        setStatus(ConnectionStatus::DISCONNECTED);
-        eventManager_.emit("OnError", { "Exception: " + std::string(e.what()) });
-        Logger::instance().error("ConnectionThreadFunc exception: " + std::string(e.what()));
 
-        if (!stopThread_.load()) {
-            attemptReconnect();
-            return;
+        refreshRequested_ = false;
+        lock.unlock();
+        if (hasUnboundServerMethods()) {
+            refreshServerHandlers(activeUrl(), options);
         }
+        lock.lock();
     }
-    catch (...) {
-        setStatus(ConnectionStatus::DISCONNECTED);
-        eventManager_.emit("OnError", { "Unknown exception" });
-        Logger::instance().error("ConnectionThreadFunc unknown exception");
-    }
-
-    if (threadConnection) {
-        setStatus(ConnectionStatus::DISCONNECTING);
-        Logger::instance().info("Stopping connection...");
+}
 
-        std::promise<void> stopPromise;
-        auto stopFuture = stopPromise.get_future();
+bool WebSClient::prepareStandby(const std::string& url, const ConnectOptions& options) {
+    TraceSpan span("standby.prepare", "connect");
+    Logger::instance().debug(logTag() + "Preparing standby connection to: " + url);
 
-        threadConnection->stop([&stopPromise](std::exception_ptr) {
-            stopPromise.set_value();
-        });
+    uint64_t generation = nextGeneration_.fetch_add(1) + 1;
+    std::set<std::string> boundMethods;
+    std::shared_ptr<HubConnection> standby;
 
-        if (stopFuture.wait_for(std::chrono::seconds(5)) == std::future_status::timeout) {
-            Logger::instance().error("Connection stop timed out");
+    try {
+        standby = buildConnection(url, options, generation, boundMethods);
+        if (!startConnection(*standby, options.connectTimeoutMs, true)) {
+            // Stopped, or abandoned so a drop or refresh is handled now; retried on a later wait
+            retireConnection(std::move(standby));
+            return true;
         }
+    } catch (const std::exception& e) {
+        Logger::instance().warning(logTag() + "Standby connection failed: " + std::string(e.what()));
+        retireConnection(std::move(standby));
+        return false;
     }
 
     {
         std::lock_guard<std::mutex> lock(connectionMutex_);
-        connection_ = nullptr;
+        standby_ = std::move(standby);
+        standbyGeneration_ = generation;
+        standbyUrl_ = url;
+        standbyBoundMethods_ = std::move(boundMethods);
     }
-    threadConnection = nullptr;
-    destroyed_ = true;
-
-    setStatus(ConnectionStatus::DISCONNECTED);
-    Logger::instance().info("Connection thread finished.");
+    Logger::instance().info(logTag() + "Standby connection ready.");
+    return true;
 }
 
-void WebSClient::handleDisconnected(std::exception_ptr ex) {
-    if (destroyed_.load() || status_.load() == ConnectionStatus::DISCONNECTED) {
-        return;
+bool WebSClient::promoteStandby() {
+    std::shared_ptr<HubConnection> failed;
+    {
+        std::lock_guard<std::mutex> lock(connectionMutex_);
+        if (!standby_) {
+            return false;
+        }
+        // The standby's handlers drop messages until its generation becomes the active one
+        failed = std::move(connection_);
+        connection_ = std::move(standby_);
+        connectionGeneration_ = standbyGeneration_;
+        currentUrl_ = standbyUrl_;
+        standbyGeneration_ = 0;
+
+        std::lock_guard<std::mutex> methodsLock(serverMethodsMutex_);
+        boundServerMethods_ = std::move(standbyBoundMethods_);
+        standbyBoundMethods_.clear();
     }
 
-    if (ex) {
-        setStatus(ConnectionStatus::DISCONNECTED);
-        eventManager_.emit("OnError", { "Disconnected due to an error" });
-        Logger::instance().error("Disconnected due to an error.");
-    } else {
-        setStatus(ConnectionStatus::DISCONNECTED);
-        eventManager_.emit("OnDisconnect");
+    retireConnection(std::move(failed));
+    endpoints_.setActive(activeUrl());
+    Logger::instance().success(logTag() + "Failed over to standby connection.");
+    emit("OnReconnected");
+    return true;
+}
+
+std::string WebSClient::standbyEndpoint(const ConnectOptions& options) const {
+    if (!options.standbyUrl.empty()) {
+        return options.standbyUrl;
     }
+    // Prefer the best other endpoint so a regional outage doesn't take both connections
+    std::string active = activeUrl();
+    std::string other = endpoints_.select(active);
+    return other.empty() ? active : other;
+}
+
+std::string WebSClient::activeUrl() const {
+    std::lock_guard<std::mutex> lock(connectionMutex_);
+    return currentUrl_;
+}
+
+StatsSnapshot WebSClient::stats() const {
+    StatsSnapshot snapshot;
+    stats_.snapshot(snapshot);
 
-    if (!stopThread_.load() && ex) {
-        attemptReconnect();
+    std::lock_guard<std::mutex> lock(contextsMutex_);
+    for (const auto& entry : contexts_) {
+        entry.second->collectStats(snapshot);
     }
+    return snapshot;
 }
 
-void WebSClient::attemptReconnect() {
-    ReconnectConfig config;
-    {
-        std::lock_guard<std::mutex> lock(reconnectMutex_);
-        config = reconnectConfig_;
+void WebSClient::resetStats() {
+    stats_.reset();
+
+    std::lock_guard<std::mutex> lock(contextsMutex_);
+    for (const auto& entry : contexts_) {
+        entry.second->resetStats();
     }
+}
+
+std::map<std::string, const MethodLatency*> WebSClient::latencies() const {
+    return stats_.latencies();
+}
+
+void WebSClient::resetLatency() {
+    stats_.resetLatency();
+}
+
+std::vector<EndpointStats> WebSClient::endpointStats() const {
+    return endpoints_.stats();
+}
+
+bool WebSClient::hasStandby() const {
+    std::lock_guard<std::mutex> lock(connectionMutex_);
+    return standby_ != nullptr;
+}
 
+std::shared_ptr<HubConnection> WebSClient::takeStandby() {
+    std::lock_guard<std::mutex> lock(connectionMutex_);
+    standbyGeneration_ = 0;
+    standbyUrl_.clear();
+    standbyBoundMethods_.clear();
+    return std::move(standby_);
+}
+
+bool WebSClient::waitForReconnect(int retryAfterMs) {
+    ReconnectConfig config = reconnectConfig();
     if (!config.enabled) {
-        return;
+        return false;
     }
 
-    if (reconnecting_.load()) {
-        return;
+    int attempts = reconnectAttempts_.fetch_add(1) + 1;
+    ClientStats::add(stats_.reconnectAttempts);
+
+    if (config.maxAttempts > 0 && attempts > config.maxAttempts) {
+        Logger::instance().error(logTag() + "Max reconnection attempts reached");
+        setStatus(ConnectionStatus::DISCONNECTED);
+        emit("OnDisconnect");
+        return false;
+    }
+
+    int delay = calculateBackoffDelay(attempts - 1);
+    if (retryAfterMs > delay) {
+        Logger::instance().verbose("Honoring server retry hint of " + std::to_string(retryAfterMs) + "ms");
+        delay = retryAfterMs;
     }
+    Logger::instance().info(logTag() + "Reconnecting in " + std::to_string(delay) + "ms (attempt " + std::to_string(attempts) + ")");
+
+    setStatus(ConnectionStatus::RECONNECTING);
+    emit("OnReconnecting", { std::to_string(attempts) });
+
+    // Disconnect() interrupts the backoff immediately
+    TraceSpan span("reconnect.backoff", "connect");
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    return !stateCv_.wait_for(lock, std::chrono::milliseconds(delay), [this] {
+        return stopThread_.load();
+    });
+}
+
+void WebSClient::refreshServerHandlers(const std::string& url, const ConnectOptions& options) {
+    // SignalR only accepts handlers before start(), so methods registered while connected are
+    // picked up by starting a replacement connection and retiring the old one once it is live.
+    Logger::instance().info(logTag() + "Refreshing server handlers on a replacement connection...");
+    TraceSpan span("handlers.refresh", "connect");
 
-    reconnecting_ = true;
+    uint64_t generation = nextGeneration_.fetch_add(1) + 1;
+    std::set<std::string> boundMethods;
+    std::shared_ptr<HubConnection> replacement;
 
-    std::string url, token;
+    try {
+        replacement = buildConnection(url, options, generation, boundMethods);
+        if (!startConnection(*replacement, options.connectTimeoutMs)) {
+            retireConnection(std::move(replacement));
+            return;
+        }
+    } catch (const std::exception& e) {
+        Logger::instance().warning("Handler refresh failed, keeping current connection: " + std::string(e.what()));
+        retireConnection(std::move(replacement));
+        return;
+    }
+
+    std::shared_ptr<HubConnection> previous;
     {
         std::lock_guard<std::mutex> lock(connectionMutex_);
-        url = currentUrl_;
-        token = currentToken_;
+        previous = std::move(connection_);
+        connection_ = replacement;
+        connectionGeneration_ = generation;
+    }
+    {
+        std::lock_guard<std::mutex> lock(serverMethodsMutex_);
+        boundServerMethods_ = std::move(boundMethods);
     }
 
-    while (!stopThread_.load()) {
-        int attempts = reconnectAttempts_.fetch_add(1) + 1;
+    // Stopping the old connection fails its in-flight SendMessageAsync calls (documented)
+    retireConnection(std::move(previous));
+    // The standby was built with the old handler set; it is rebuilt on the next wait
+    retireConnection(takeStandby());
+    Logger::instance().success(logTag() + "Server handlers refreshed.");
+    emit("OnReconnected");
+}
 
-        if (config.maxAttempts > 0 && attempts > config.maxAttempts) {
-            Logger::instance().error("Max reconnection attempts reached");
-            setStatus(ConnectionStatus::DISCONNECTED);
-            eventManager_.emit("OnDisconnect");
-            reconnecting_ = false;
-            return;
+// Lives for the client's lifetime and runs one connection session per Connect() request,
+// so Connect() and Disconnect() only post requests and never join anything.
+void WebSClient::connectionThreadFunc() {
+    Logger::instance().debug("Connection thread started");
+    Tracer::instance().setThreadName("connection");
+    Logger::instance().verbose("Thread ID: " + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())));
+
+    while (true) {
+        ConnectOptions options;
+        {
+            std::unique_lock<std::mutex> lock(stateMutex_);
+            stateCv_.wait(lock, [this] { return connectRequested_ || workerExit_; });
+            if (workerExit_) break;
+
+            options = std::move(pendingOptions_);
+            connectRequested_ = false;
+            stopThread_ = false;
+            droppedConnections_.clear();
+            refreshRequested_ = false;
         }
 
-        int delay = calculateBackoffDelay(attempts - 1);
-        Logger::instance().info("Reconnecting in " + std::to_string(delay) + "ms (attempt " + std::to_string(attempts) + ")");
+        destroyed_ = false;
+        reconnectAttempts_ = 0;
+        runSession(options);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        workerDone_ = true;
+    }
+    stateCv_.notify_all();
+    Logger::instance().debug("Connection thread exited");
+}
 
-        setStatus(ConnectionStatus::RECONNECTING);
-        eventManager_.emit("OnReconnecting", { std::to_string(attempts) });
+// Connection state machine. Every transition is driven by stateCv_: start completion,
+// transport disconnects, handler refresh requests and Disconnect() wake it immediately.
+void WebSClient::runSession(const ConnectOptions& options) {
+    bool reconnecting = false;
+    bool connected = false;
+    std::string url;
+    int retryAfterMs = 0;
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    endpoints_.setEndpoints(options.urls);
 
-        if (stopThread_.load()) {
+    while (!stopThread_.load()) {
+        if (reconnecting && !waitForReconnect(retryAfterMs)) {
             break;
         }
 
+        auto attemptStarted = std::chrono::steady_clock::now();
         try {
+            TraceSpan attemptSpan(reconnecting ? "reconnect.attempt" : "connect.attempt", "connect");
             setStatus(ConnectionStatus::CONNECTING);
-            Logger::instance().info("Reconnecting to: " + url);
-
-            auto newConnection = signalr::hub_connection_builder::create(url)
-                .with_logging(Logger::getShared(), signalr::trace_level::verbose)
-                .build();
+            {
+                // Only endpoints without a cached RTT are probed; failures rotate to the next best
+                TraceSpan span("connect.probe", "connect");
+                endpoints_.probe(*transport_, options);
+                url = endpoints_.select();
+            }
+            Logger::instance().info(logTag() + (reconnecting ? "Reconnecting to: " : "Connecting to: ") + url);
 
-            if (!token.empty()) {
-                signalr::signalr_client_config cfg;
-                cfg.get_http_headers().emplace("Authorization", token);
-                cfg.set_proxy({ web::web_proxy::use_auto_discovery });
-                newConnection.set_client_config(cfg);
+            uint64_t generation = nextGeneration_.fetch_add(1) + 1;
+            std::set<std::string> boundMethods;
+            std::shared_ptr<HubConnection> newConnection;
+            {
+                TraceSpan span("connect.build", "connect");
+                newConnection = buildConnection(url, options, generation, boundMethods);
             }
 
-            newConnection.set_disconnected([this](std::exception_ptr ex) {
-                handleDisconnected(ex);
-            });
+            {
+                std::lock_guard<std::mutex> lock(connectionMutex_);
+                connection_ = newConnection;
+                connectionGeneration_ = generation;
+                currentUrl_ = url;
+            }
 
-            registerAllServerMethods(newConnection);
+            if (!startConnection(*newConnection, options.connectTimeoutMs)) {
+                break;
+            }
 
-            std::atomic<bool> started{ false };
-            std::atomic<bool> failed{ false };
+            {
+                std::lock_guard<std::mutex> lock(serverMethodsMutex_);
+                boundServerMethods_ = std::move(boundMethods);
+            }
+        }
+        catch (const std::exception& e) {
+            ErrorClassification failure = classifyError(std::current_exception());
+            retireConnection(takeConnection());
+            if (stopThread_.load()) {
+                break;
+            }
+            endpoints_.reportFailure(url);
 
-            newConnection.start([&started, &failed](std::exception_ptr ex) {
-                if (ex) failed = true;
-                else started = true;
-            });
+            if (reconnecting) {
+                Logger::instance().error(logTag() + "Reconnect failed: " + std::string(e.what()));
+            } else {
+                setStatus(ConnectionStatus::DISCONNECTED);
+                emit("OnError", { "Exception: " + std::string(e.what()) });
+                Logger::instance().error(logTag() + "ConnectionThreadFunc exception: " + std::string(e.what()));
+            }
 
-            auto start_time = std::chrono::steady_clock::now();
-            while (!started.load() && !failed.load()) {
-                if (stopThread_.load()) {
+            if (!failure.retryable) {
+                // e.g. a rejected token: retrying would only hammer the hub with the same request
+                Logger::instance().error(logTag() + "Error is not retryable (HTTP " + std::to_string(failure.statusCode) + "), giving up");
+                if (reconnecting) {
                     setStatus(ConnectionStatus::DISCONNECTED);
-                    reconnecting_ = false;
-                    return;
-                }
-                if (std::chrono::steady_clock::now() - start_time > std::chrono::seconds(15)) {
-                    throw std::runtime_error("Connection timeout");
+                    emit("OnError", { "Reconnect aborted: " + std::string(e.what()) });
+                    emit("OnDisconnect");
                 }
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                break;
             }
+            retryAfterMs = failure.retryAfterMs;
+            reconnecting = true;
+            continue;
+        }
 
-            if (failed.load()) {
-                throw std::runtime_error("Failed to reconnect");
-            }
+        connected = true;
+        stats_.recordConnect(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - attemptStarted).count(), reconnecting);
+        endpoints_.reportSuccess(url);
+        endpoints_.setActive(url);
+        setStatus(ConnectionStatus::CONNECTED);
+        reconnectAttempts_ = 0;
+        retryAfterMs = 0;
+        if (reconnecting) {
+            Logger::instance().success(logTag() + "Reconnected successfully.");
+            emit("OnReconnected");
+        } else {
+            Logger::instance().success(logTag() + "Connected successfully to hub.");
+            emit("OnConnect");
+        }
+        reconnecting = false;
 
-            {
-                std::lock_guard<std::mutex> lock(connectionMutex_);
-                connection_ = std::make_shared<signalr::hub_connection>(std::move(newConnection));
-                destroyed_ = false;
-            }
+        std::exception_ptr error;
+        if (!waitWhileConnected(options, error)) {
+            break;
+        }
 
-            setStatus(ConnectionStatus::CONNECTED);
-            reconnectAttempts_ = 0;
-            reconnecting_ = false;
-            Logger::instance().success("Reconnected successfully.");
-            eventManager_.emit("OnReconnected");
+        // The transport dropped the connection and there was no standby to take over
+        connected = false;
+        retireConnection(takeConnection());
+        setStatus(ConnectionStatus::DISCONNECTED);
 
-            while (!stopThread_.load() && status_.load() == ConnectionStatus::CONNECTED) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(200));
-            }
-            return;
+        if (!error) {
+            emit("OnDisconnect");
+            break;
+        }
 
-        } catch (const std::exception& e) {
-            Logger::instance().error("Reconnect failed: " + std::string(e.what()));
-            continue;
+        ErrorClassification failure = classifyError(error);
+        endpoints_.reportFailure(activeUrl());
+        emit("OnError", { "Disconnected due to an error" + (failure.message.empty() ? std::string() : ": " + failure.message) });
+        Logger::instance().error(logTag() + "Disconnected due to an error." + (failure.message.empty() ? std::string() : " " + failure.message));
+        if (!failure.retryable) {
+            emit("OnDisconnect");
+            break;
         }
+        retryAfterMs = failure.retryAfterMs;
+        reconnecting = true;
     }
 
-    setStatus(ConnectionStatus::DISCONNECTED);
-    reconnecting_ = false;
+    retireConnection(takeStandby());
+
+    std::shared_ptr<HubConnection> activeConnection = takeConnection();
+    if (activeConnection) {
+        if (connected) {
+            setStatus(ConnectionStatus::DISCONNECTING);
+        }
+        Logger::instance().info(logTag() + "Stopping connection...");
+        retireConnection(std::move(activeConnection));
+        if (connected) {
+            emit("OnDisconnect");
+        }
+    }
+    destroyed_ = true;
+
+    {
+        std::lock_guard<std::mutex> lock(serverMethodsMutex_);
+        boundServerMethods_.clear();
+    }
+
+    // A superseding Connect() already reported "connecting"; don't flicker through "disconnected"
+    bool superseded;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        superseded = connectRequested_;
+    }
+    setStatus(superseded ? ConnectionStatus::CONNECTING : ConnectionStatus::DISCONNECTED);
+    Logger::instance().info(logTag() + "Connection session finished.");
+}
+
+void WebSClient::handleDisconnected(uint64_t generation, std::exception_ptr ex) {
+    if (destroyed_.load()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        droppedConnections_.push_back({ generation, ex });
+    }
+    stateCv_.notify_all();
 }
 
 void WebSClient::disconnect() {
@@ -426,13 +1139,25 @@ void WebSClient::disconnect() {
     ConnectionStatus currentStatus = status_.load();
     Logger::instance().verbose("Current status: " + std::string(ConnectionStatusToString(currentStatus)));
 
-    if (currentStatus == ConnectionStatus::DISCONNECTED) {
+    bool pending;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        pending = connectRequested_;
+        connectRequested_ = false;
+        stopThread_ = true;
+    }
+    stateCv_.notify_all();
+    endpoints_.cancelProbes();
+
+    if (currentStatus == ConnectionStatus::DISCONNECTED && !pending) {
         Logger::instance().verbose("Already disconnected, ignoring");
         return;
     }
 
-    stopThread_ = true;
-    Logger::instance().info("Disconnect requested.");
+    if (pending) {
+        setStatus(ConnectionStatus::DISCONNECTED);
+    }
+    Logger::instance().info(logTag() + "Disconnect requested.");
 }
 
 std::string WebSClient::connectionId() const {
@@ -443,17 +1168,18 @@ std::string WebSClient::connectionId() const {
     }
 
     try {
-        return connection_->get_connection_id();
+        return connection_->connectionId();
     } catch (...) {
         return "";
     }
 }
 
-bool WebSClient::send(const std::string& method, const std::vector<signalr::value>& args) {
-    Logger::instance().debug("Send called: method=" + method + ", args=" + std::to_string(args.size()));
+bool WebSClient::send(const std::string& method, const std::vector<Value>& args) {
+    Logger::instance().logf(LogLevel::Debug, LogFormat::SendCalled, method, args.size());
 
     if (status_.load() != ConnectionStatus::CONNECTED) {
         Logger::instance().warning("Send failed: not connected");
+        ClientStats::add(stats_.sendFailures);
         return false;
     }
 
@@ -461,163 +1187,140 @@ bool WebSClient::send(const std::string& method, const std::vector<signalr::valu
         std::lock_guard<std::mutex> lock(connectionMutex_);
         if (!connection_) {
             Logger::instance().warning("Send failed: connection is null");
+            ClientStats::add(stats_.sendFailures);
             return false;
         }
 
-        Logger::instance().verbose("Invoking method: " + method);
-        connection_->invoke(method, args, [method](const signalr::value&, std::exception_ptr e) {
+        MethodCounters& counters = stats_.method(method);
+        ClientStats::add(counters.messagesOut);
+        ClientStats::add(counters.bytesOut, ClientStats::payloadBytes(args));
+
+        Logger::instance().logf(LogLevel::Verbose, LogFormat::InvokingMethod, method);
+        connection_->invoke(method, args, [this, method](const Value&, std::exception_ptr e) {
             if (e) {
+                ClientStats::add(stats_.sendFailures);
                 Logger::instance().error("SendMessage invoke callback reported failure for method: " + method);
             } else {
-                Logger::instance().verbose("SendMessage completed successfully for method: " + method);
+                Logger::instance().logf(LogLevel::Verbose, LogFormat::SendCompleted, method);
             }
         });
         return true;
     } catch (const std::exception& e) {
         Logger::instance().error("Send failed: " + std::string(e.what()));
+        ClientStats::add(stats_.sendFailures);
         return false;
     }
 }
 
-bool WebSClient::sendAsync(const std::string& method, const std::vector<signalr::value>& args, int callbackRef) {
-    Logger::instance().debug("SendAsync called: method=" + method + ", args=" + std::to_string(args.size()) + ", callbackRef=" + std::to_string(callbackRef));
+bool WebSClient::sendAsync(lua_State* L, const std::string& method, const std::vector<Value>& args, int callbackRef) {
+    auto enqueuedAt = std::chrono::steady_clock::now();
+    Logger::instance().logf(LogLevel::Debug, LogFormat::SendAsyncCalled, method, args.size(), callbackRef);
 
     if (status_.load() != ConnectionStatus::CONNECTED) {
         Logger::instance().warning("SendAsync failed: not connected");
+        ClientStats::add(stats_.sendFailures);
         return false;
     }
 
+    bool inFlight = false;
     try {
         std::lock_guard<std::mutex> lock(connectionMutex_);
         if (!connection_) {
             Logger::instance().warning("SendAsync failed: connection is null");
+            ClientStats::add(stats_.sendFailures);
             return false;
         }
 
-        Logger::instance().verbose("Invoking async method: " + method);
-        connection_->invoke(method, args, [this, callbackRef, method](const signalr::value& result, std::exception_ptr e) {
+        MethodCounters& counters = stats_.method(method);
+        ClientStats::add(counters.messagesOut);
+        ClientStats::add(counters.bytesOut, ClientStats::payloadBytes(args));
+
+        // The result goes back to the calling script; if it has been unloaded meanwhile, it is dropped
+        std::weak_ptr<LuaContext> weakContext = context(L);
+
+        // invoke() returns once the message is handed to the transport; the completion can race it
+        MethodLatency* latency = &stats_.latency(method);
+        auto writtenAt = std::make_shared<std::atomic<int64_t>>(0);
+
+        Logger::instance().logf(LogLevel::Verbose, LogFormat::InvokingAsyncMethod, method);
+        stats_.invocationsInFlight.fetch_add(1, std::memory_order_relaxed);
+        inFlight = true;
+        connection_->invoke(method, args, [this, weakContext, callbackRef, method, latency, enqueuedAt, writtenAt](const Value& result, std::exception_ptr e) {
+            auto completedAt = std::chrono::steady_clock::now();
+            // A completion that beat invoke()'s return has no hand-off time: skip the round-trip
+            // sample rather than record a fake 0
+            int64_t written = writtenAt->load(std::memory_order_acquire);
+            if (written) {
+                latency->roundTrip.record(completedAt - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(written)));
+            }
+
+            stats_.invocationsInFlight.fetch_sub(1, std::memory_order_relaxed);
+            if (e) ClientStats::add(stats_.sendFailures);
             if (destroyed_.load()) {
                 Logger::instance().verbose("SendAsync callback ignored: destroyed");
                 return;
             }
+            auto ctx = weakContext.lock();
+            if (!ctx) {
+                ClientStats::add(stats_.droppedResults);
+                Logger::instance().verbose("SendAsync callback ignored: Lua context closed");
+                return;
+            }
             AsyncResult res;
             res.callbackRef = callbackRef;
             res.success = !e;
+            res.method = method;
+            res.latency = latency;
+            res.enqueuedAt = enqueuedAt;
+            res.completedAt = completedAt;
             if (e) {
                 res.error = "Invoke failed";
                 Logger::instance().error("SendMessageAsync invoke callback reported failure for method: " + method);
             } else {
-                Logger::instance().verbose("SendMessageAsync completed successfully for method: " + method);
+                Logger::instance().logf(LogLevel::Verbose, LogFormat::SendAsyncCompleted, method);
                 res.result = result;
             }
-            asyncResultsQueue_.push(res);
+            ctx->pushAsyncResult(std::move(res));
         });
+
+        auto handedOff = std::chrono::steady_clock::now();
+        writtenAt->store(handedOff.time_since_epoch().count(), std::memory_order_release);
+        latency->send.record(handedOff - enqueuedAt);
         return true;
     } catch (const std::exception& e) {
         Logger::instance().error("SendAsync failed: " + std::string(e.what()));
+        ClientStats::add(stats_.sendFailures);
+        if (inFlight) stats_.invocationsInFlight.fetch_sub(1, std::memory_order_relaxed);
         return false;
     }
 }
 
-std::string WebSClient::getMessage() {
-    std::string msg;
-    if (messageQueue_.tryPop(msg)) {
-        return msg;
-    }
-    return "";
-}
-
-size_t WebSClient::queueSize() const {
-    return messageQueue_.size();
-}
-
 int WebSClient::processEvents(lua_State* L) {
-    if (!L || destroyed_.load() || stopThread_.load()) {
+    if (!L || shutdown_.load()) {
         return 0;
     }
 
-    int processed = eventManager_.processEvents(L);
-
-    std::queue<ServerMessage> serverMsgsToProcess;
-    {
-        std::queue<ServerMessage> temp;
-        serverMessageQueue_.swap(temp);
-        serverMsgsToProcess = std::move(temp);
-    }
-
-    while (!serverMsgsToProcess.empty()) {
-        ServerMessage msg = std::move(serverMsgsToProcess.front());
-        serverMsgsToProcess.pop();
-
-        std::vector<std::string> strArgs;
-        for (const auto& arg : msg.args) {
-            if (arg.is_string()) {
-                strArgs.push_back(arg.as_string());
-            } else if (arg.is_double()) {
-                strArgs.push_back(std::to_string(arg.as_double()));
-            } else if (arg.is_bool()) {
-                strArgs.push_back(arg.as_bool() ? "true" : "false");
-            }
-        }
-
-        eventManager_.emit(msg.method, strArgs);
-        processed++;
-    }
-
-    processed += eventManager_.processEvents(L);
-
-    std::queue<AsyncResult> resultsToProcess;
-    {
-        std::queue<AsyncResult> temp;
-        asyncResultsQueue_.swap(temp);
-        resultsToProcess = std::move(temp);
-    }
-
-    while (!resultsToProcess.empty()) {
-        AsyncResult res = std::move(resultsToProcess.front());
-        resultsToProcess.pop();
-
-        if (res.callbackRef != LUA_NOREF && res.callbackRef != -1) {
-            if (!lua_checkstack(L, 10)) {
-                Logger::instance().error("Lua stack overflow risk in async callback");
-                luaL_unref(L, LUA_REGISTRYINDEX, res.callbackRef);
-                continue;
-            }
-
-            int top = lua_gettop(L);
-            lua_rawgeti(L, LUA_REGISTRYINDEX, res.callbackRef);
-
-            if (lua_isfunction(L, -1)) {
-                lua_pushboolean(L, res.success);
-
-                if (res.success) {
-                    pushSignalRValueToLua(L, res.result);
-                } else {
-                    lua_pushstring(L, res.error.c_str());
-                }
-
-                if (lua_pcall(L, 2, 0, 0) != 0) {
-                    const char* err = lua_tostring(L, -1);
-                    Logger::instance().error("Error in async callback: " + std::string(err ? err : "unknown"));
-                }
-            } else {
-                Logger::instance().error("Async callback ref is not a function!");
-            }
-
-            lua_settop(L, top);
-            luaL_unref(L, LUA_REGISTRYINDEX, res.callbackRef);
-            processed++;
-        }
-    }
-
-    return processed;
+    return context(L)->processEvents(L);
 }
 
 void WebSClient::shutdown() {
+    beginShutdown();
+    finishShutdown(std::chrono::steady_clock::now() + std::chrono::milliseconds(ShutdownTimeoutMs), false);
+}
+
+void WebSClient::beginShutdown() {
     Logger::instance().debug("Shutdown initiated");
 
+    shutdown_ = true;
     destroyed_ = true;
-    stopThread_ = true;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        stopThread_ = true;
+        connectRequested_ = false;
+        workerExit_ = true;
+    }
+    stateCv_.notify_all();
+    endpoints_.cancelProbes();
 
     if (status_.load() != ConnectionStatus::DISCONNECTED) {
         Logger::instance().verbose("Stopping active connection...");
@@ -626,58 +1329,88 @@ void WebSClient::shutdown() {
             if (connection_) {
                 connection_->stop([](std::exception_ptr) {});
             }
+            if (standby_) {
+                standby_->stop([](std::exception_ptr) {});
+            }
         } catch (...) {
             Logger::instance().warning("Exception during connection stop (ignored)");
         }
     }
+}
 
+void WebSClient::finishShutdown(std::chrono::steady_clock::time_point deadline, bool underLoaderLock) {
+    // Wait for the connection thread only until the deadline, then detach it instead of
+    // joining. Under the loader lock (DLL detach) even a finished thread can't exit until we
+    // return, so workerDone_ counts as completion and it is never joined.
     if (connectionThread_ && connectionThread_->joinable()) {
         Logger::instance().verbose("Waiting for connection thread to finish...");
-        connectionThread_->join();
-        Logger::instance().verbose("Connection thread finished");
+        bool done;
+        {
+            std::unique_lock<std::mutex> lock(stateMutex_);
+            done = stateCv_.wait_until(lock, deadline, [this] { return workerDone_; });
+        }
+        if (done) {
+            if (underLoaderLock) {
+                connectionThread_->detach();
+            } else {
+                connectionThread_->join();
+            }
+            Logger::instance().verbose("Connection thread finished");
+        } else {
+            Logger::instance().warning(logTag() + "Connection thread did not finish in time, detaching");
+            connectionThread_->detach();
+        }
     }
     connectionThread_.reset();
 
+    // The replay thread delivers to the contexts cleared below
+    replay_.stop(deadline, underLoaderLock);
+    recorder_.stop();
+
     {
         std::lock_guard<std::mutex> lock(connectionMutex_);
         connection_ = nullptr;
+        standby_ = nullptr;
     }
-
-    if (luaState_) {
-        Logger::instance().verbose("Clearing event manager...");
-        eventManager_.clear(luaState_);
+    if (transport_) {
+        // On DLL detach this may drop the last scheduler reference; see SignalRTransport::release
+        transport_->release(underLoaderLock);
     }
 
-    Logger::instance().verbose("Clearing message queues...");
-    messageQueue_.clear();
-    asyncResultsQueue_.clear();
-    serverMessageQueue_.clear();
+    Logger::instance().verbose("Clearing Lua contexts...");
+    {
+        std::lock_guard<std::mutex> lock(contextsMutex_);
+        for (const auto& entry : contexts_) {
+            entry.second->clear();
+        }
+        contexts_.clear();
+    }
 
     setStatus(ConnectionStatus::DISCONNECTED);
-    Logger::instance().info("Shutdown complete");
+    Logger::instance().info(logTag() + "Shutdown complete");
 }
 
-static void pushSignalRValueToLuaImpl(lua_State* L, const signalr::value& val, int depth) {
+static void pushValueToLuaImpl(lua_State* L, const Value& val, int depth) {
     if (depth > 50) {
-        Logger::instance().error("SignalR value too deeply nested");
+        Logger::instance().error("Value too deeply nested");
         lua_pushnil(L);
         return;
     }
 
     switch (val.type()) {
-        case signalr::value_type::string:
+        case ValueType::string:
             lua_pushstring(L, val.as_string().c_str());
             break;
-        case signalr::value_type::float64:
+        case ValueType::float64:
             lua_pushnumber(L, val.as_double());
             break;
-        case signalr::value_type::boolean:
+        case ValueType::boolean:
             lua_pushboolean(L, val.as_bool());
             break;
-        case signalr::value_type::null:
+        case ValueType::null:
             lua_pushnil(L);
             break;
-        case signalr::value_type::array: {
+        case ValueType::array: {
             const auto& arr = val.as_array();
             if (!lua_checkstack(L, 3)) {
                 lua_pushnil(L);
@@ -685,12 +1418,12 @@ static void pushSignalRValueToLuaImpl(lua_State* L, const signalr::value& val, i
             }
             lua_newtable(L);
             for (size_t i = 0; i < arr.size(); ++i) {
-                pushSignalRValueToLuaImpl(L, arr[i], depth + 1);
+                pushValueToLuaImpl(L, arr[i], depth + 1);
                 lua_rawseti(L, -2, static_cast<int>(i + 1));
             }
             break;
         }
-        case signalr::value_type::map: {
+        case ValueType::map: {
             const auto& map = val.as_map();
             if (!lua_checkstack(L, 4)) {
                 lua_pushnil(L);
@@ -699,12 +1432,12 @@ static void pushSignalRValueToLuaImpl(lua_State* L, const signalr::value& val, i
             lua_newtable(L);
             for (const auto& pair : map) {
                 lua_pushstring(L, pair.first.c_str());
-                pushSignalRValueToLuaImpl(L, pair.second, depth + 1);
+                pushValueToLuaImpl(L, pair.second, depth + 1);
                 lua_settable(L, -3);
             }
             break;
         }
-        case signalr::value_type::binary: {
+        case ValueType::binary: {
             const auto& bin = val.as_binary();
             lua_pushlstring(L, reinterpret_cast<const char*>(bin.data()), bin.size());
             break;
@@ -715,8 +1448,8 @@ static void pushSignalRValueToLuaImpl(lua_State* L, const signalr::value& val, i
     }
 }
 
-void pushSignalRValueToLua(lua_State* L, const signalr::value& val) {
-    pushSignalRValueToLuaImpl(L, val, 0);
+void pushValueToLua(lua_State* L, const Value& val) {
+    pushValueToLuaImpl(L, val, 0);
 }
 
 } // namespace WebS
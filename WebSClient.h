@@ -5,12 +5,18 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <map>
 #include <set>
+#include <random>
 #include "Types.h"
-#include "ThreadSafeQueue.h"
-#include "EventManager.h"
-#include "signalrclient/hub_connection.h"
+#include "LuaContext.h"
+#include "MessageFilter.h"
+#include "Transport.h"
+#include "EndpointSelector.h"
+#include "ClientStats.h"
+#include "TrafficRecorder.h"
 
 extern "C" {
 #include "lua.h"
@@ -18,16 +24,25 @@ extern "C" {
 
 namespace WebS {
 
-struct ServerMessage {
-    std::string method;
-    std::vector<signalr::value> args;
-};
-
 class WebSClient {
 public:
+    static const char* const DefaultClientName;
+    static constexpr int ShutdownTimeoutMs = 2000;   // Worst case for DLL detach
+    static constexpr int MaxSchedulerThreads = 8;
+    static constexpr int StandbyRetryMs = 5000;
+    static constexpr int MaxRetryAfterSeconds = 600;
+
+    // The default client backs the global WebS.* API; named clients are
+    // independent connections created by WebS.NewClient(name).
     static WebSClient& instance();
+    static WebSClient& get(const std::string& name);
+    // underLoaderLock: called from DllMain, where a thread that has finished its work still
+    // can't exit, so threads are detached instead of joined
+    static void shutdownAll(bool underLoaderLock);
+
+    const std::string& name() const;
 
-    bool connect(const std::string& url, const std::string& token = "");
+    bool connect(const std::string& url, const ConnectOptions& options = ConnectOptions());
     void disconnect();
     ConnectionStatus status() const;
     std::string connectionId() const;
@@ -36,61 +51,135 @@ public:
     ReconnectConfig reconnectConfig() const;
     int reconnectAttempts() const;
 
-    bool send(const std::string& method, const std::vector<signalr::value>& args);
-    bool sendAsync(const std::string& method, const std::vector<signalr::value>& args, int callbackRef);
-    std::string getMessage();
-    size_t queueSize() const;
+    bool send(const std::string& method, const std::vector<Value>& args);
+    bool sendAsync(lua_State* L, const std::string& method, const std::vector<Value>& args, int callbackRef);
 
-    void registerServerMethod(const std::string& methodName);
-    void unregisterServerMethod(const std::string& methodName);
+    void registerServerMethod(lua_State* L, const std::string& methodName, int callbackRef, std::shared_ptr<const MessageFilter> filter = nullptr);
+    void unregisterServerMethod(lua_State* L, const std::string& methodName, int callbackRef);
 
-    EventManager& events();
+    std::shared_ptr<LuaContext> attach(lua_State* L);
+    void detach(lua_State* L);
+    std::shared_ptr<LuaContext> context(lua_State* L);
+    size_t contextCount() const;
     int processEvents(lua_State* L);
 
-    void setLuaState(lua_State* L);
-    lua_State* luaState() const;
     void shutdown();
 
+    SchedulerStats schedulerStats() const;
+    std::vector<EndpointStats> endpointStats() const;
+
+    StatsSnapshot stats() const;
+    void resetStats();
+
+    // SendMessageAsync latency per method; pointers stay valid for the client's lifetime
+    std::map<std::string, const MethodLatency*> latencies() const;
+    void resetLatency();
+
+    // Inbound invocations to a file, and a recording fed back through the same delivery path
+    bool startRecording(const std::string& path);
+    uint64_t stopRecording();
+    bool startReplay(const std::string& path, double speed, std::string& error);
+    void stopReplay();
+
+    // Blocks until the connection is stopped or 5 s have passed
+    static void stopConnection(const std::shared_ptr<HubConnection>& conn);
+
     WebSClient(const WebSClient&) = delete;
     WebSClient& operator=(const WebSClient&) = delete;
 
 private:
-    WebSClient() = default;
+    friend struct std::default_delete<WebSClient>;
+
+    explicit WebSClient(const std::string& name);
     ~WebSClient();
 
-    void connectionThreadFunc(std::string url, std::string token);
-    void handleDisconnected(std::exception_ptr ex);
-    void attemptReconnect();
+    std::string logTag() const;
+
+    void connectionThreadFunc();
+    void runSession(const ConnectOptions& options);
+    void beginShutdown();
+    void finishShutdown(std::chrono::steady_clock::time_point deadline, bool underLoaderLock);
+    void handleDisconnected(uint64_t generation, std::exception_ptr ex);
+    bool waitWhileConnected(const ConnectOptions& options, std::exception_ptr& error);
+    bool waitForReconnect(int retryAfterMs);
     int calculateBackoffDelay(int attempt);
+    ErrorClassification classifyError(std::exception_ptr error) const;
     void setStatus(ConnectionStatus status);
-    void registerAllServerMethods(signalr::hub_connection& conn);
+    void emit(const std::string& eventName, const std::vector<std::string>& args = {});
+    std::set<std::string> subscribedMethods() const;
+    std::set<std::string> registerAllServerMethods(HubConnection& conn, uint64_t generation);
+    void dispatchServerMessage(const std::string& methodName, const std::vector<Value>& args, MethodCounters& counters);
+    bool hasUnboundServerMethods() const;
+    void requestRefresh();
+    std::shared_ptr<HubConnection> buildConnection(const std::string& url, const ConnectOptions& options, uint64_t generation, std::set<std::string>& boundMethods);
+    // False when stopped, or with abandonOnEvents when a drop or refresh request needs the state machine
+    bool startConnection(HubConnection& conn, int timeoutMs, bool abandonOnEvents = false);
+    bool stateEventPending() const;   // Under stateMutex_
+    std::shared_ptr<HubConnection> takeConnection();
+    void retireConnection(std::shared_ptr<HubConnection> conn);
+    void refreshServerHandlers(const std::string& url, const ConnectOptions& options);
+    bool prepareStandby(const std::string& url, const ConnectOptions& options);
+    bool promoteStandby();
+    bool hasStandby() const;
+    std::string standbyEndpoint(const ConnectOptions& options) const;
+    std::string activeUrl() const;
+    std::shared_ptr<HubConnection> takeStandby();
+
+    const std::string name_;
+    const std::string contextRegistryKey_;
 
     std::atomic<ConnectionStatus> status_{ConnectionStatus::DISCONNECTED};
-    std::shared_ptr<signalr::hub_connection> connection_;
-    lua_State* luaState_ = nullptr;
-    std::string currentUrl_;
-    std::string currentToken_;
+    std::shared_ptr<HubConnection> connection_;
+    std::atomic<uint64_t> connectionGeneration_{0};   // Generation whose messages are delivered
+    std::atomic<uint64_t> nextGeneration_{0};
+
+    // Warm standby, started with handlers bound but muted until promoted
+    std::shared_ptr<HubConnection> standby_;
+    uint64_t standbyGeneration_ = 0;
+    std::string standbyUrl_;
+    std::set<std::string> standbyBoundMethods_;
+
+    std::unique_ptr<Transport> transport_;   // Null when the build has no transport factory
+    std::string currentUrl_;   // Endpoint of the active connection
+    EndpointSelector endpoints_;
+    ClientStats stats_;
+    TrafficRecorder recorder_;
+    TrafficReplay replay_;
+    ConnectOptions currentOptions_;
 
     ReconnectConfig reconnectConfig_;
+    double previousDelayMs_ = 0;   // Decorrelated jitter state, guarded by reconnectMutex_
+    std::mt19937 random_{ std::random_device{}() };
     std::atomic<int> reconnectAttempts_{0};
-    std::atomic<bool> reconnecting_{false};
     mutable std::mutex reconnectMutex_;
 
     std::unique_ptr<std::thread> connectionThread_;
     std::atomic<bool> stopThread_{false};
     std::atomic<bool> destroyed_{false};
+    std::atomic<bool> shutdown_{false};
+
+    // Signals for the connection state machine; written under stateMutex_, then stateCv_ is notified
+    std::mutex stateMutex_;
+    std::condition_variable stateCv_;
+    struct DroppedConnection {
+        uint64_t generation;
+        std::exception_ptr error;
+    };
+    std::vector<DroppedConnection> droppedConnections_;
+    bool refreshRequested_ = false;
+    bool connectRequested_ = false;
+    ConnectOptions pendingOptions_;
+    bool workerExit_ = false;
+    bool workerDone_ = false;
     mutable std::mutex connectionMutex_;
 
-    ThreadSafeQueue<std::string> messageQueue_;
-    ThreadSafeQueue<AsyncResult> asyncResultsQueue_;
-    ThreadSafeQueue<ServerMessage> serverMessageQueue_;
+    std::map<lua_State*, std::shared_ptr<LuaContext>> contexts_;
+    mutable std::mutex contextsMutex_;
 
-    std::set<std::string> registeredServerMethods_;
+    std::set<std::string> boundServerMethods_;
     mutable std::mutex serverMethodsMutex_;
-
-    EventManager eventManager_;
 };
 
-void pushSignalRValueToLua(lua_State* L, const signalr::value& val);
+void pushValueToLua(lua_State* L, const Value& val);
 
 } // namespace WebS
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <benchmark/benchmark.h>
+
+namespace WebS {
+namespace Bench {
+
+// Heap allocations made by the calling thread; counted by the operator new replacement in main.cpp
+uint64_t threadAllocations();
+
+// Reports the allocations the benchmarked thread made between construction and
+// destruction as "allocs/op". Counters are summed over threads and divided by the
+// total iteration count, so multi-threaded runs report the same unit.
+class AllocCounter {
+public:
+    explicit AllocCounter(benchmark::State& state) : state_(state), start_(threadAllocations()) {}
+
+    ~AllocCounter() {
+        state_.counters["allocs/op"] = benchmark::Counter(
+            static_cast<double>(threadAllocations() - start_), benchmark::Counter::kAvgIterations);
+    }
+
+    AllocCounter(const AllocCounter&) = delete;
+    AllocCounter& operator=(const AllocCounter&) = delete;
+
+private:
+    benchmark::State& state_;
+    uint64_t start_;
+};
+
+} // namespace Bench
+} // namespace WebS
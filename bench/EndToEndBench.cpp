@@ -0,0 +1,168 @@
+// Whole client path against the in-process loopback hub: SendMessage through the transport,
+// the hub's framing, delivery and the Lua handlers, plus reconnect after a dropped connection.
+// Times are wall-clock; the hub thread stands in for the network thread.
+
+#include "AllocCounter.h"
+#include "LoopbackHub.h"
+#include "LoopbackTransport.h"
+#include "WebSClient.h"
+#include "LuaContext.h"
+#include "EventManager.h"
+#include "Logger.h"
+
+#include <chrono>
+#include <thread>
+
+extern "C" {
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+}
+
+using namespace WebS;
+
+namespace {
+
+constexpr int WaitTimeoutMs = 5000;
+
+// Clients take their transport when created, so every benchmark shares one hub
+std::shared_ptr<LoopbackHub> sharedHub() {
+    static std::shared_ptr<LoopbackHub> hub = [] {
+        auto created = std::make_shared<LoopbackHub>();
+        LoopbackTransport::install(created);
+        return created;
+    }();
+    return hub;
+}
+
+// One client connected to the hub, with a Lua handler counting calls of `method`
+struct Session {
+    std::shared_ptr<LoopbackHub> hub = sharedHub();
+    WebSClient& client = WebSClient::get("bench-e2e");
+    lua_State* L = luaL_newstate();
+    bool connected = false;
+
+    explicit Session(const std::string& method, const ReconnectConfig& reconnect = ReconnectConfig()) {
+        Logger::instance().setMinLevel(LogLevel::Warning);
+        luaL_openlibs(L);
+        luaL_dostring(L, "calls = 0");
+
+        client.attach(L);
+        luaL_dostring(L, "return function(...) calls = calls + 1 end");
+        int ref = client.context(L)->events().on(L, method, lua_gettop(L));
+        lua_pop(L, 1);
+        client.registerServerMethod(L, method, ref);
+
+        client.setReconnectConfig(reconnect);
+        client.connect("http://loopback/hub");
+        connected = waitForStatus(ConnectionStatus::CONNECTED);
+    }
+
+    ~Session() {
+        client.disconnect();
+        waitForStatus(ConnectionStatus::DISCONNECTED);
+        client.detach(L);
+        lua_close(L);
+    }
+
+    bool waitForStatus(ConnectionStatus status) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WaitTimeoutMs);
+        while (client.status() != status) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    double calls() {
+        lua_getglobal(L, "calls");
+        double n = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+        return n;
+    }
+
+    // Runs processEvents until the handler has been called `target` times
+    bool pumpUntil(double target) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WaitTimeoutMs);
+        while (calls() < target) {
+            if (client.processEvents(L) == 0) {
+                if (std::chrono::steady_clock::now() > deadline) return false;
+                std::this_thread::yield();
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+// SendMessage("Echo", i) until the hub's Echo comes back into the Lua handler
+static void BM_EndToEnd_EchoRoundTrip(benchmark::State& state) {
+    Session session("Echo");
+    if (!session.connected) {
+        state.SkipWithError("loopback connect timed out");
+        return;
+    }
+
+    double expected = 0;
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        session.client.send("Echo", { Value(expected) });
+        if (!session.pumpUntil(++expected)) {
+            state.SkipWithError("echo timed out");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EndToEnd_EchoRoundTrip)->UseRealTime();
+
+// Unthrottled server broadcast of range(0) messages, drained by processEvents
+static void BM_EndToEnd_Broadcast(benchmark::State& state) {
+    Session session("OnPosition");
+    if (!session.connected) {
+        state.SkipWithError("loopback connect timed out");
+        return;
+    }
+
+    const std::vector<Value> args = { Value(1.0), Value(2.0), Value(3.0), Value(std::string("player")) };
+    double expected = 0;
+    for (auto _ : state) {
+        expected += static_cast<double>(state.range(0));
+        session.hub->startBroadcast("OnPosition", args, 0, static_cast<uint64_t>(state.range(0)));
+        if (!session.pumpUntil(expected)) {
+            state.SkipWithError("broadcast timed out");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EndToEnd_Broadcast)->Arg(1000)->Arg(10000)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Hub drops the connection; time until the client is CONNECTED again with no backoff delay
+static void BM_EndToEnd_Reconnect(benchmark::State& state) {
+    ReconnectConfig reconnect;
+    reconnect.enabled = true;
+    reconnect.maxAttempts = 0;
+    reconnect.initialDelayMs = 0;
+    reconnect.jitter = JitterMode::NONE;
+    Session session("Echo", reconnect);
+    if (!session.connected) {
+        state.SkipWithError("loopback connect timed out");
+        return;
+    }
+
+    for (auto _ : state) {
+        uint64_t connects = session.hub->stats().connects;
+        session.hub->dropConnections();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WaitTimeoutMs);
+        while (session.hub->stats().connects == connects || session.client.status() != ConnectionStatus::CONNECTED) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                state.SkipWithError("reconnect timed out");
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+BENCHMARK(BM_EndToEnd_Reconnect)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,206 @@
+// Lua side of the bridge: argument conversion in both directions and event delivery to
+// 1..100 subscribed handlers. Runs against the embedded Lua 5.1.
+
+#include "AllocCounter.h"
+#include "LuaBindings.h"
+#include "LuaContext.h"
+#include "EventManager.h"
+#include "WebSClient.h"
+#include "Logger.h"
+
+extern "C" {
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+}
+
+using namespace WebS;
+
+namespace {
+
+struct LuaState {
+    lua_State* L;
+
+    LuaState() : L(luaL_newstate()) {
+        luaL_openlibs(L);
+        Logger::instance().setMinLevel(LogLevel::Warning);
+    }
+    ~LuaState() { lua_close(L); }
+};
+
+Value flatValue() {
+    std::vector<Value> items;
+    for (int i = 0; i < 8; ++i) {
+        items.push_back(i % 2 ? Value(static_cast<double>(i)) : Value(std::string("item")));
+    }
+    return Value(std::move(items));
+}
+
+Value nestedValue(int depth) {
+    if (depth == 0) return Value(42.0);
+    std::map<std::string, Value> fields;
+    fields["a"] = nestedValue(depth - 1);
+    fields["b"] = nestedValue(depth - 1);
+    fields["name"] = Value(std::string("node"));
+    fields["list"] = Value(std::vector<Value>{ Value(1.0), Value(true), Value(std::string("x")) });
+    return Value(std::move(fields));
+}
+
+// Pushes function(...) end handlers counting their calls in the global "calls"
+void pushHandler(lua_State* L) {
+    luaL_dostring(L, "return function(...) calls = calls + 1 end");
+}
+
+} // namespace
+
+static void BM_TableToArgs(benchmark::State& state) {
+    LuaState lua;
+    lua_State* L = lua.L;
+    lua_newtable(L);
+    for (int i = 1; i <= state.range(0); ++i) {
+        if (i % 3 == 0) lua_pushboolean(L, 1);
+        else if (i % 3 == 1) lua_pushnumber(L, i);
+        else lua_pushstring(L, "argument");
+        lua_rawseti(L, -2, i);
+    }
+    int index = lua_gettop(L);
+
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        std::vector<Value> args = LuaBindings::tableToArgs(L, index);
+        benchmark::DoNotOptimize(args.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TableToArgs)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+static void pushValueLoop(benchmark::State& state, const Value& value) {
+    LuaState lua;
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        pushValueToLua(lua.L, value);
+        lua_pop(lua.L, 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_PushValue_Flat(benchmark::State& state) {
+    pushValueLoop(state, flatValue());
+}
+BENCHMARK(BM_PushValue_Flat);
+
+static void BM_PushValue_Nested(benchmark::State& state) {
+    pushValueLoop(state, nestedValue(static_cast<int>(state.range(0))));
+}
+BENCHMARK(BM_PushValue_Nested)->DenseRange(1, 5, 2);
+
+static void BM_PushValue_Binary(benchmark::State& state) {
+    Value value(std::vector<uint8_t>(static_cast<size_t>(state.range(0)), 0x5a));
+    pushValueLoop(state, value);
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PushValue_Binary)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+// Internal events (OnConnect, OnError, ...): emit on one side, processEvents on the game thread
+static void BM_EventManager_ProcessEvents(benchmark::State& state) {
+    LuaState lua;
+    lua_State* L = lua.L;
+    luaL_dostring(L, "calls = 0");
+
+    EventManager events;
+    events.setLegacyCallbacks(false);
+    for (int i = 0; i < state.range(0); ++i) {
+        pushHandler(L);
+        events.on(L, "OnBench", lua_gettop(L));
+        lua_pop(L, 1);
+    }
+
+    const std::vector<std::string> args = { "reason", "42" };
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        events.emit("OnBench", args);
+        events.processEvents(L);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EventManager_ProcessEvents)->RangeMultiplier(10)->Range(1, 100);
+
+// Server invocations: deliver() on the hub thread's side, conversion and handler calls in processEvents
+static void BM_LuaContext_ServerMessages(benchmark::State& state) {
+    LuaState lua;
+    lua_State* L = lua.L;
+    luaL_dostring(L, "calls = 0");
+
+    LuaContext context(L);
+    context.events().setLegacyCallbacks(false);
+    for (int i = 0; i < state.range(0); ++i) {
+        pushHandler(L);
+        int ref = context.events().on(L, "OnPosition", lua_gettop(L));
+        lua_pop(L, 1);
+        context.subscribe("OnPosition", ref, nullptr);
+    }
+
+    const std::vector<Value> args = { Value(1.0), Value(2.0), Value(3.0), Value(std::string("player")) };
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        context.deliver("OnPosition", args);
+        context.processEvents(L);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LuaContext_ServerMessages)->RangeMultiplier(10)->Range(1, 100);
+
+// A high-rate method at 10k msg/s as the game thread sees it: each iteration is one frame at
+// range(0) fps, delivering that frame's share of the messages and running processEvents once.
+// The On and OnBatch variants do the same handler work, so the pair shows what batching saves
+// per frame; delivery is included in both.
+constexpr int PacedMessagesPerSecond = 10000;
+
+static void pacedDelivery(benchmark::State& state, bool batched) {
+    LuaState lua;
+    lua_State* L = lua.L;
+    luaL_dostring(L, "calls = 0");
+
+    LuaContext context(L);
+    context.events().setLegacyCallbacks(false);
+    int ref;
+    if (batched) {
+        luaL_dostring(L, "return function(batch, count) calls = calls + count end");
+        ref = context.events().onBatch(L, "OnPosition", lua_gettop(L));
+    } else {
+        pushHandler(L);
+        ref = context.events().on(L, "OnPosition", lua_gettop(L));
+    }
+    lua_pop(L, 1);
+    context.subscribe("OnPosition", ref, nullptr);
+
+    const int perFrame = PacedMessagesPerSecond / static_cast<int>(state.range(0));
+    const std::vector<Value> args = { Value(1.0), Value(2.0), Value(3.0), Value(std::string("player")) };
+    {
+        Bench::AllocCounter allocs(state);
+        for (auto _ : state) {
+            for (int i = 0; i < perFrame; ++i) {
+                context.deliver("OnPosition", args);
+            }
+            context.processEvents(L);
+        }
+    }
+
+    lua_getglobal(L, "calls");
+    if (lua_tonumber(L, -1) != static_cast<double>(state.iterations()) * perFrame) {
+        state.SkipWithError("handler missed messages");
+    }
+    lua_pop(L, 1);
+    state.SetItemsProcessed(state.iterations() * perFrame);
+    state.counters["msgs/frame"] = perFrame;
+}
+
+static void BM_LuaContext_Paced_On(benchmark::State& state) {
+    pacedDelivery(state, false);
+}
+BENCHMARK(BM_LuaContext_Paced_On)->Arg(30)->Arg(60)->Arg(144)->ArgName("fps");
+
+static void BM_LuaContext_Paced_OnBatch(benchmark::State& state) {
+    pacedDelivery(state, true);
+}
+BENCHMARK(BM_LuaContext_Paced_OnBatch)->Arg(30)->Arg(60)->Arg(144)->ArgName("fps");
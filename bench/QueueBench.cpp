@@ -0,0 +1,50 @@
+// ThreadSafeQueue (server messages, events, async results) and BoundedQueue (log records)
+// under contention: every thread pushes one item and pops one per iteration.
+
+#include "AllocCounter.h"
+#include "ThreadSafeQueue.h"
+#include "BoundedQueue.h"
+#include "Types.h"
+
+using namespace WebS;
+
+static void BM_ThreadSafeQueue_PushPop(benchmark::State& state) {
+    static ThreadSafeQueue<int> queue;
+    Bench::AllocCounter allocs(state);
+    int item = 0;
+    for (auto _ : state) {
+        queue.push(item);
+        benchmark::DoNotOptimize(queue.tryPop(item));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ThreadSafeQueue_PushPop)->ThreadRange(1, 8)->UseRealTime();
+
+// The payload the SignalR callback thread hands to the game thread
+static void BM_ThreadSafeQueue_ServerMessage(benchmark::State& state) {
+    static ThreadSafeQueue<ServerMessage> queue;
+    ServerMessage message;
+    message.method = "OnPosition";
+    message.args = { Value(1.0), Value(2.0), Value(std::string("player")) };
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        queue.push(message);
+        ServerMessage out;
+        benchmark::DoNotOptimize(queue.tryPop(out));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ThreadSafeQueue_ServerMessage)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_BoundedQueue_PushPop(benchmark::State& state) {
+    static BoundedQueue<int> queue(1024);
+    Bench::AllocCounter allocs(state);
+    int item = 0;
+    for (auto _ : state) {
+        int pushed = item;
+        benchmark::DoNotOptimize(queue.tryPush(pushed));
+        benchmark::DoNotOptimize(queue.tryPop(item));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BoundedQueue_PushPop)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,58 @@
+// Per-send stats bookkeeping: WebSClient::send/sendAsync look up the method's counters (and
+// for SendMessageAsync its latency histograms) on every call, under shared locks that all
+// sending threads share.
+
+#include "AllocCounter.h"
+#include "ClientStats.h"
+
+using namespace WebS;
+
+namespace {
+
+// One client's stats shared by every benchmark thread, with a realistic number of methods
+ClientStats& sharedStats() {
+    static ClientStats stats;
+    static bool populated = [] {
+        for (int i = 0; i < 32; ++i) {
+            stats.method("Method" + std::to_string(i));
+        }
+        return true;
+    }();
+    (void)populated;
+    return stats;
+}
+
+} // namespace
+
+// What send() adds per call: counters lookup, two relaxed adds and the payload size
+static void BM_ClientStats_SendLookup(benchmark::State& state) {
+    ClientStats& stats = sharedStats();
+    const std::string method = "UpdatePosition";
+    const std::vector<Value> args = { Value(1.0), Value(2.0), Value(3.0), Value(std::string("player")) };
+
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        MethodCounters& counters = stats.method(method);
+        ClientStats::add(counters.messagesOut);
+        ClientStats::add(counters.bytesOut, ClientStats::payloadBytes(args));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClientStats_SendLookup)->ThreadRange(1, 8)->UseRealTime();
+
+// sendAsync() additionally resolves the method's latency histograms
+static void BM_ClientStats_SendAsyncLookup(benchmark::State& state) {
+    ClientStats& stats = sharedStats();
+    const std::string method = "UpdatePosition";
+    const std::vector<Value> args = { Value(1.0), Value(2.0), Value(3.0), Value(std::string("player")) };
+
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        MethodCounters& counters = stats.method(method);
+        ClientStats::add(counters.messagesOut);
+        ClientStats::add(counters.bytesOut, ClientStats::payloadBytes(args));
+        benchmark::DoNotOptimize(&stats.latency(method));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClientStats_SendAsyncLookup)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,71 @@
+// Recording cost on the SignalR callback thread, and how fast a recording decodes for replay.
+// The recording goes to webs_bench.rec in the working directory.
+
+#include "AllocCounter.h"
+#include "TrafficRecorder.h"
+#include "Logger.h"
+
+using namespace WebS;
+
+namespace {
+
+const char* const RecordingPath = "webs_bench.rec";
+
+std::vector<Value> positionArgs() {
+    std::map<std::string, Value> player;
+    player["name"] = Value(std::string("player"));
+    player["health"] = Value(100.0);
+    return { Value(1.0), Value(2.0), Value(3.0), Value(std::move(player)) };
+}
+
+} // namespace
+
+static void BM_TrafficRecorder_Record(benchmark::State& state) {
+    Logger::instance().setMinLevel(LogLevel::Warning);
+    TrafficRecorder recorder;
+    if (!recorder.start(RecordingPath)) {
+        state.SkipWithError("failed to open recording file");
+        return;
+    }
+
+    const std::vector<Value> args = positionArgs();
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        recorder.record("OnPosition", args);
+    }
+    recorder.stop();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrafficRecorder_Record);
+
+static void BM_TrafficReader_Next(benchmark::State& state) {
+    Logger::instance().setMinLevel(LogLevel::Warning);
+    {
+        TrafficRecorder recorder;
+        recorder.start(RecordingPath);
+        const std::vector<Value> args = positionArgs();
+        for (int i = 0; i < 10000; ++i) {
+            recorder.record(i % 4 ? "OnPosition" : "OnChat", args);
+        }
+    }
+
+    TrafficReader reader;
+    std::string error;
+    TrafficReader::Record record;
+    uint64_t decoded = 0;
+    Bench::AllocCounter allocs(state);
+    for (auto _ : state) {
+        if (!reader.next(record)) {
+            state.PauseTiming();
+            if (!reader.open(RecordingPath, error)) {
+                state.SkipWithError(error.c_str());
+                break;
+            }
+            state.ResumeTiming();
+            reader.next(record);
+        }
+        ++decoded;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(decoded));
+}
+BENCHMARK(BM_TrafficReader_Next);
@@ -0,0 +1,51 @@
+// Microbenchmarks for the bridge's hot paths.
+//
+//   webs_bench --benchmark_out=bench.json --benchmark_out_format=json
+//
+// Every benchmark reports "allocs/op": heap allocations per iteration made by the
+// benchmarked thread (background threads such as the log writer are not counted).
+
+#include "AllocCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local uint64_t allocations = 0;
+
+void* allocate(std::size_t size) {
+    ++allocations;
+    if (size == 0) size = 1;
+    if (void* p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+    ++allocations;
+    std::size_t align = static_cast<std::size_t>(alignment);
+    size = (size + align - 1) / align * align;
+    if (void* p = std::aligned_alloc(align, size ? size : align)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+uint64_t WebS::Bench::threadAllocations() {
+    return allocations;
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+BENCHMARK_MAIN();
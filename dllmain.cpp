@@ -1,15 +1,9 @@
 #include "pch.h"
 #include "WebSClient.h"
-#include "LuaBindings.h"
 #include "Logger.h"
 #include "Version.h"
 #include <delayimp.h>
 
-extern "C" {
-#include "lauxlib.h"
-#include "lua.h"
-}
-
 static HMODULE g_hModule = nullptr;
 static std::string g_dllDirectory;
 
@@ -58,7 +52,8 @@ static bool LoadDependencies(HMODULE hModule) {
         "microsoft-signalr.dll"
     };
 
-    std::ofstream logfile("websocketLogging.txt", std::ios::app);
+    // Through the Logger: the log file is preallocated and memory-mapped, so a second
+    // writer appending to it would land past the mapped region
     bool allLoaded = true;
 
     for (const char* dep : dependencies) {
@@ -66,15 +61,11 @@ static bool LoadDependencies(HMODULE hModule) {
         HMODULE hDep = LoadLibraryA(fullPath.c_str());
         if (!hDep) {
             DWORD err = GetLastError();
-            if (logfile.is_open()) {
-                logfile << "[WARN] Could not load " << dep << " from " << g_dllDirectory
-                        << " (Error: " << err << "). Trying system path..." << std::endl;
-            }
+            WebS::Logger::instance().warning(std::string("Could not load ") + dep + " from " + g_dllDirectory +
+                " (Error: " + std::to_string(err) + "). Trying system path...");
             hDep = LoadLibraryA(dep);
             if (!hDep) {
-                if (logfile.is_open()) {
-                    logfile << "[ERROR] Failed to load " << dep << " from any location." << std::endl;
-                }
+                WebS::Logger::instance().error(std::string("Failed to load ") + dep + " from any location.");
                 allLoaded = false;
             }
         }
@@ -83,13 +74,6 @@ static bool LoadDependencies(HMODULE hModule) {
     return allLoaded;
 }
 
-extern "C" __declspec(dllexport) int luaopen_WebS(lua_State* L) {
-    WebS::Logger::instance().info("WebS DLL Loaded and Initialized.");
-    WebS::WebSClient::instance().setLuaState(L);
-    WebS::LuaBindings::registerAll(L);
-    return 1;
-}
-
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
     switch (ul_reason_for_call) {
     case DLL_PROCESS_ATTACH: {
@@ -106,10 +90,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
         WebS::Logger::instance().info(std::string("=== WebS v") + WebS::Version + " session started ===");
 
         if (!LoadDependencies(hModule)) {
-            std::ofstream logfile("websocketLogging.txt", std::ios::app);
-            if (logfile.is_open()) {
-                logfile << "[CRITICAL] Some dependencies failed to load!" << std::endl;
-            }
+            WebS::Logger::instance().critical("Some dependencies failed to load!");
         }
         break;
     }
@@ -117,8 +98,10 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
     case DLL_PROCESS_DETACH:
         if (lpReserved == nullptr) {
             SetDllDirectoryA(nullptr);
-            WebS::WebSClient::instance().shutdown();
+            // Under the loader lock: threads are signalled and waited for, but never joined
+            WebS::WebSClient::shutdownAll(true);
             WebS::Logger::instance().info("WebS DLL Unloading.");
+            WebS::Logger::instance().shutdown(std::chrono::steady_clock::now() + std::chrono::milliseconds(500), true);
         }
         break;
     }
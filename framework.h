@@ -1,5 +1,6 @@
 ﻿#pragma once
 
 #define WIN32_LEAN_AND_MEAN             // Исключите редко используемые компоненты из заголовков Windows
+#define NOMINMAX                        // std::min/std::max instead of the windows.h macros
 // Файлы заголовков Windows
 #include <windows.h>
@@ -0,0 +1,410 @@
+#include "pch.h"
+#include "HubProtocol.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+namespace WebS {
+namespace HubProtocol {
+
+namespace {
+
+const char Base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void writeBase64(const std::vector<uint8_t>& data, std::string& out) {
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t chunk = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out += Base64Alphabet[(chunk >> 18) & 63];
+        out += Base64Alphabet[(chunk >> 12) & 63];
+        out += Base64Alphabet[(chunk >> 6) & 63];
+        out += Base64Alphabet[chunk & 63];
+    }
+    if (i < data.size()) {
+        uint32_t chunk = data[i] << 16;
+        if (i + 1 < data.size()) chunk |= data[i + 1] << 8;
+        out += Base64Alphabet[(chunk >> 18) & 63];
+        out += Base64Alphabet[(chunk >> 12) & 63];
+        out += i + 1 < data.size() ? Base64Alphabet[(chunk >> 6) & 63] : '=';
+        out += '=';
+    }
+}
+
+void writeString(const std::string& text, std::string& out) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+                break;
+        }
+    }
+    out += '"';
+}
+
+void appendUtf8(uint32_t codepoint, std::string& out) {
+    if (codepoint < 0x80) {
+        out += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+        out += static_cast<char>(0xc0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    } else if (codepoint < 0x10000) {
+        out += static_cast<char>(0xe0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (codepoint & 0x3f));
+    }
+}
+
+class JsonReader {
+public:
+    explicit JsonReader(const std::string& text) : p_(text.c_str()), end_(text.c_str() + text.size()) {}
+
+    bool document(Value& out) {
+        if (!value(out, 0)) return false;
+        skipSpace();
+        return p_ == end_;
+    }
+
+private:
+    static constexpr int MaxDepth = 64;
+
+    void skipSpace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_;
+    }
+
+    bool literal(const char* word) {
+        size_t length = std::strlen(word);
+        if (static_cast<size_t>(end_ - p_) < length || std::strncmp(p_, word, length) != 0) return false;
+        p_ += length;
+        return true;
+    }
+
+    bool hex4(uint32_t& out) {
+        if (end_ - p_ < 4) return false;
+        out = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = *p_++;
+            out <<= 4;
+            if (c >= '0' && c <= '9') out |= c - '0';
+            else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    bool string(std::string& out) {
+        if (p_ >= end_ || *p_ != '"') return false;
+        ++p_;
+        while (p_ < end_) {
+            char c = *p_++;
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (p_ >= end_) return false;
+            switch (*p_++) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t codepoint;
+                    if (!hex4(codepoint)) return false;
+                    if (codepoint >= 0xd800 && codepoint < 0xdc00 && end_ - p_ >= 6 && p_[0] == '\\' && p_[1] == 'u') {
+                        p_ += 2;
+                        uint32_t low;
+                        if (!hex4(low)) return false;
+                        codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(codepoint, out);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    bool value(Value& out, int depth) {
+        if (depth > MaxDepth) return false;
+        skipSpace();
+        if (p_ >= end_) return false;
+
+        switch (*p_) {
+            case '{': {
+                ++p_;
+                std::map<std::string, Value> fields;
+                skipSpace();
+                if (p_ < end_ && *p_ == '}') {
+                    ++p_;
+                    out = Value(std::move(fields));
+                    return true;
+                }
+                while (true) {
+                    skipSpace();
+                    std::string key;
+                    if (!string(key)) return false;
+                    skipSpace();
+                    if (p_ >= end_ || *p_++ != ':') return false;
+                    Value item;
+                    if (!value(item, depth + 1)) return false;
+                    fields[key] = std::move(item);
+                    skipSpace();
+                    if (p_ >= end_) return false;
+                    if (*p_ == ',') { ++p_; continue; }
+                    if (*p_++ != '}') return false;
+                    out = Value(std::move(fields));
+                    return true;
+                }
+            }
+            case '[': {
+                ++p_;
+                std::vector<Value> items;
+                skipSpace();
+                if (p_ < end_ && *p_ == ']') {
+                    ++p_;
+                    out = Value(std::move(items));
+                    return true;
+                }
+                while (true) {
+                    Value item;
+                    if (!value(item, depth + 1)) return false;
+                    items.push_back(std::move(item));
+                    skipSpace();
+                    if (p_ >= end_) return false;
+                    if (*p_ == ',') { ++p_; continue; }
+                    if (*p_++ != ']') return false;
+                    out = Value(std::move(items));
+                    return true;
+                }
+            }
+            case '"': {
+                std::string text;
+                if (!string(text)) return false;
+                out = Value(std::move(text));
+                return true;
+            }
+            case 't':
+                if (!literal("true")) return false;
+                out = Value(true);
+                return true;
+            case 'f':
+                if (!literal("false")) return false;
+                out = Value(false);
+                return true;
+            case 'n':
+                if (!literal("null")) return false;
+                out = Value();
+                return true;
+            default: {
+                char* numberEnd = nullptr;
+                double number = std::strtod(p_, &numberEnd);
+                if (numberEnd == p_ || numberEnd > end_) return false;
+                p_ = numberEnd;
+                out = Value(number);
+                return true;
+            }
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+const Value* field(const std::map<std::string, Value>& fields, const char* name) {
+    auto it = fields.find(name);
+    return it == fields.end() ? nullptr : &it->second;
+}
+
+} // namespace
+
+void writeJson(const Value& value, std::string& out) {
+    switch (value.type()) {
+        case ValueType::string:
+            writeString(value.as_string(), out);
+            break;
+        case ValueType::float64: {
+            double number = value.as_double();
+            if (!std::isfinite(number)) {
+                out += "null";
+            } else if (number == std::floor(number) && std::fabs(number) < 1e15) {
+                out += std::to_string(static_cast<long long>(number));
+            } else {
+                char text[32];
+                std::snprintf(text, sizeof(text), "%.17g", number);
+                out += text;
+            }
+            break;
+        }
+        case ValueType::boolean:
+            out += value.as_bool() ? "true" : "false";
+            break;
+        case ValueType::binary:
+            out += '"';
+            writeBase64(value.as_binary(), out);
+            out += '"';
+            break;
+        case ValueType::array: {
+            out += '[';
+            bool first = true;
+            for (const auto& item : value.as_array()) {
+                if (!first) out += ',';
+                first = false;
+                writeJson(item, out);
+            }
+            out += ']';
+            break;
+        }
+        case ValueType::map: {
+            out += '{';
+            bool first = true;
+            for (const auto& entry : value.as_map()) {
+                if (!first) out += ',';
+                first = false;
+                writeString(entry.first, out);
+                out += ':';
+                writeJson(entry.second, out);
+            }
+            out += '}';
+            break;
+        }
+        default:
+            out += "null";
+            break;
+    }
+}
+
+bool readJson(const std::string& text, Value& out) {
+    return JsonReader(text).document(out);
+}
+
+std::string handshakeRequest() {
+    return std::string("{\"protocol\":\"json\",\"version\":1}") + RecordSeparator;
+}
+
+std::string handshakeResponse(const std::string& error) {
+    if (error.empty()) return std::string("{}") + RecordSeparator;
+    std::string out = "{\"error\":";
+    writeString(error, out);
+    out += '}';
+    out += RecordSeparator;
+    return out;
+}
+
+bool parseHandshakeResponse(const std::string& frame, std::string& error) {
+    Value response;
+    if (!readJson(frame, response) || !response.is_map()) {
+        error = "Invalid handshake response";
+        return false;
+    }
+    const Value* message = field(response.as_map(), "error");
+    error = message && message->is_string() ? message->as_string() : "";
+    return error.empty();
+}
+
+std::string encode(const HubMessage& message) {
+    std::string out = "{\"type\":";
+    out += std::to_string(static_cast<int>(message.type));
+    if (!message.invocationId.empty()) {
+        out += ",\"invocationId\":";
+        writeString(message.invocationId, out);
+    }
+    switch (message.type) {
+        case MessageType::Invocation:
+            out += ",\"target\":";
+            writeString(message.target, out);
+            out += ",\"arguments\":[";
+            for (size_t i = 0; i < message.arguments.size(); ++i) {
+                if (i > 0) out += ',';
+                writeJson(message.arguments[i], out);
+            }
+            out += ']';
+            break;
+        case MessageType::Completion:
+            if (!message.error.empty()) {
+                out += ",\"error\":";
+                writeString(message.error, out);
+            } else if (!message.result.is_null()) {
+                out += ",\"result\":";
+                writeJson(message.result, out);
+            }
+            break;
+        case MessageType::Close:
+            if (!message.error.empty()) {
+                out += ",\"error\":";
+                writeString(message.error, out);
+            }
+            break;
+        default:
+            break;
+    }
+    out += '}';
+    out += RecordSeparator;
+    return out;
+}
+
+bool decode(const std::string& frame, HubMessage& message) {
+    Value parsed;
+    if (!readJson(frame, parsed) || !parsed.is_map()) return false;
+    const auto& fields = parsed.as_map();
+
+    const Value* type = field(fields, "type");
+    if (!type || !type->is_double()) return false;
+    message.type = static_cast<MessageType>(static_cast<int>(type->as_double()));
+
+    if (const Value* id = field(fields, "invocationId")) {
+        if (id->is_string()) message.invocationId = id->as_string();
+    }
+    if (const Value* target = field(fields, "target")) {
+        if (target->is_string()) message.target = target->as_string();
+    }
+    if (const Value* arguments = field(fields, "arguments")) {
+        if (arguments->is_array()) message.arguments = arguments->as_array();
+    }
+    if (const Value* result = field(fields, "result")) {
+        message.result = *result;
+    }
+    if (const Value* error = field(fields, "error")) {
+        if (error->is_string()) message.error = error->as_string();
+    }
+    return true;
+}
+
+void splitFrames(std::string& buffer, std::vector<std::string>& frames) {
+    size_t start = 0;
+    size_t end;
+    while ((end = buffer.find(RecordSeparator, start)) != std::string::npos) {
+        frames.emplace_back(buffer, start, end - start);
+        start = end + 1;
+    }
+    buffer.erase(0, start);
+}
+
+} // namespace HubProtocol
+} // namespace WebS
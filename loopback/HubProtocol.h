@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Value.h"
+
+namespace WebS {
+
+// The SignalR JSON hub protocol: JSON messages terminated by the 0x1E record separator,
+// preceded by a {"protocol":"json","version":1} handshake. Enough of it for the loopback
+// hub to cost what the real wire format costs; binary values travel as base64 strings.
+namespace HubProtocol {
+
+const char RecordSeparator = '\x1e';
+
+enum class MessageType {
+    Invocation = 1,
+    Completion = 3,
+    Ping = 6,
+    Close = 7
+};
+
+struct HubMessage {
+    MessageType type = MessageType::Ping;
+    std::string invocationId;      // Invocation/Completion; empty = no completion expected
+    std::string target;            // Invocation
+    std::vector<Value> arguments;  // Invocation
+    Value result;                  // Completion
+    std::string error;             // Completion/Close; empty = none
+};
+
+std::string handshakeRequest();
+// An empty error is a successful handshake
+std::string handshakeResponse(const std::string& error = "");
+// False when the hub rejected the handshake (or the frame isn't one); error then holds why
+bool parseHandshakeResponse(const std::string& frame, std::string& error);
+
+std::string encode(const HubMessage& message);
+// frame: one message without its record separator; false when it is not a message
+bool decode(const std::string& frame, HubMessage& message);
+
+// Appends the complete frames in buffer to frames and keeps the unterminated rest in buffer
+void splitFrames(std::string& buffer, std::vector<std::string>& frames);
+
+void writeJson(const Value& value, std::string& out);
+// Parses one JSON document; false on malformed input
+bool readJson(const std::string& text, Value& out);
+
+} // namespace HubProtocol
+} // namespace WebS
@@ -0,0 +1,386 @@
+#include "pch.h"
+#include "LoopbackHub.h"
+#include "HubProtocol.h"
+
+namespace WebS {
+
+using namespace HubProtocol;
+
+LoopbackHub::LoopbackHub() {
+    thread_ = std::thread(&LoopbackHub::run, this);
+}
+
+LoopbackHub::~LoopbackHub() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    // The last owner can be a connection released by a callback on the hub thread itself
+    if (std::this_thread::get_id() == thread_.get_id()) {
+        thread_.detach();
+    } else {
+        thread_.join();
+    }
+}
+
+void LoopbackHub::setMethod(const std::string& name, Method method) {
+    std::lock_guard<std::mutex> lock(settingsMutex_);
+    methods_[name] = std::move(method);
+}
+
+void LoopbackHub::setConnectDelay(int ms) {
+    std::lock_guard<std::mutex> lock(settingsMutex_);
+    connectDelayMs_ = ms;
+}
+
+void LoopbackHub::setCompletionDelay(int ms) {
+    std::lock_guard<std::mutex> lock(settingsMutex_);
+    completionDelayMs_ = ms;
+}
+
+void LoopbackHub::failConnects(int count, int httpStatus, const std::string& message) {
+    std::lock_guard<std::mutex> lock(settingsMutex_);
+    failConnects_ = count;
+    failStatus_ = httpStatus;
+    failMessage_ = message;
+}
+
+void LoopbackHub::broadcast(const std::string& method, const std::vector<Value>& args) {
+    HubMessage message;
+    message.type = MessageType::Invocation;
+    message.target = method;
+    message.arguments = args;
+    std::string frames = encode(message);
+    post([this, frames] { sendToAll(frames); });
+}
+
+void LoopbackHub::startBroadcast(const std::string& method, const std::vector<Value>& args, double perSecond, uint64_t count) {
+    HubMessage message;
+    message.type = MessageType::Invocation;
+    message.target = method;
+    message.arguments = args;
+    std::string frames = encode(message);
+
+    uint64_t generation = ++broadcastGeneration_;
+    post([this, generation, frames, perSecond, count] {
+        broadcastTick(generation, frames, perSecond, count, std::chrono::steady_clock::now(), 0);
+    });
+}
+
+void LoopbackHub::stopBroadcast() {
+    ++broadcastGeneration_;
+}
+
+void LoopbackHub::dropConnections(const std::string& error) {
+    post([this, error] { closeAll(error); });
+}
+
+size_t LoopbackHub::connectionCount() const {
+    return connectionCount_.load();
+}
+
+LoopbackHub::Stats LoopbackHub::stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return stats_;
+}
+
+void LoopbackHub::connect(std::shared_ptr<Peer> peer, std::function<void(std::exception_ptr, const std::string&)> done) {
+    int delayMs;
+    std::exception_ptr refusal;
+    {
+        std::lock_guard<std::mutex> lock(settingsMutex_);
+        delayMs = connectDelayMs_;
+        if (failConnects_ > 0) {
+            failConnects_--;
+            refusal = std::make_exception_ptr(LoopbackError(failMessage_ + " (HTTP " + std::to_string(failStatus_) + ")", failStatus_));
+        }
+    }
+
+    std::weak_ptr<Peer> weakPeer = peer;
+    post([this, weakPeer, refusal, done] {
+        std::shared_ptr<Peer> peer = weakPeer.lock();
+        if (refusal || !peer) {
+            {
+                std::lock_guard<std::mutex> lock(statsMutex_);
+                stats_.rejectedConnects++;
+            }
+            done(refusal ? refusal : std::make_exception_ptr(std::runtime_error("Connection was abandoned")), "");
+            return;
+        }
+
+        Session& session = sessions_[peer.get()];
+        session.peer = peer;
+        connectionCount_ = sessions_.size();
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            stats_.connects++;
+        }
+        done(nullptr, "loopback-" + std::to_string(++nextConnectionId_));
+    }, delayMs);
+}
+
+void LoopbackHub::send(const std::shared_ptr<Peer>& peer, std::string frames) {
+    Peer* key = peer.get();
+    post([this, key, frames] {
+        auto it = sessions_.find(key);
+        if (it == sessions_.end()) return;
+
+        Session& session = it->second;
+        session.buffer += frames;
+        std::vector<std::string> complete;
+        splitFrames(session.buffer, complete);
+        for (const auto& frame : complete) {
+            // The session goes away if a frame drops the connection
+            if (sessions_.find(key) == sessions_.end()) return;
+            handleFrame(key, session, frame);
+        }
+    });
+}
+
+void LoopbackHub::disconnect(const std::shared_ptr<Peer>& peer, std::function<void()> done) {
+    Peer* key = peer.get();
+    post([this, key, done] {
+        sessions_.erase(key);
+        connectionCount_ = sessions_.size();
+        done();
+    });
+}
+
+void LoopbackHub::post(std::function<void()> run, int delayMs) {
+    postAt(std::move(run), std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs));
+}
+
+void LoopbackHub::postAt(std::function<void()> run, std::chrono::steady_clock::time_point due) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push({ due, nextSequence_++, std::move(run) });
+    }
+    cv_.notify_all();
+}
+
+void LoopbackHub::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (tasks_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        auto due = tasks_.top().due;
+        if (std::chrono::steady_clock::now() < due) {
+            cv_.wait_until(lock, due);
+            continue;
+        }
+
+        std::function<void()> task = std::move(const_cast<Task&>(tasks_.top()).run);
+        tasks_.pop();
+        lock.unlock();
+        task();
+        task = nullptr;
+        lock.lock();
+    }
+}
+
+void LoopbackHub::handleFrame(Peer* key, Session& session, const std::string& frame) {
+    if (!session.handshaken) {
+        Value request;
+        std::string error;
+        if (!readJson(frame, request) || !request.is_map()) {
+            error = "Handshake request is not valid JSON";
+        } else {
+            auto protocol = request.as_map().find("protocol");
+            if (protocol == request.as_map().end() || !protocol->second.is_string() || protocol->second.as_string() != "json") {
+                error = "The protocol is not supported by the loopback hub";
+            }
+        }
+        session.handshaken = error.empty();
+        sendTo(key, handshakeResponse(error));
+        return;
+    }
+
+    HubMessage message;
+    if (!decode(frame, message)) {
+        HubMessage close;
+        close.type = MessageType::Close;
+        close.error = "Connection closed with an error. InvalidDataException: Invalid message.";
+        sendTo(key, encode(close));
+        sessions_.erase(key);
+        connectionCount_ = sessions_.size();
+        return;
+    }
+
+    switch (message.type) {
+        case MessageType::Invocation:
+            {
+                std::lock_guard<std::mutex> lock(statsMutex_);
+                stats_.invocations++;
+            }
+            invokeMethod(key, message.invocationId, message.target, message.arguments);
+            break;
+        case MessageType::Ping:
+            sendTo(key, encode(message));
+            break;
+        case MessageType::Close:
+            sessions_.erase(key);
+            connectionCount_ = sessions_.size();
+            break;
+        default:
+            break;
+    }
+}
+
+void LoopbackHub::invokeMethod(Peer* key, const std::string& invocationId, const std::string& target, const std::vector<Value>& args) {
+    Method method;
+    {
+        std::lock_guard<std::mutex> lock(settingsMutex_);
+        auto it = methods_.find(target);
+        if (it != methods_.end()) method = it->second;
+    }
+
+    if (method) {
+        try {
+            complete(key, invocationId, method(args), "");
+        } catch (const std::exception& e) {
+            complete(key, invocationId, Value(), "An unexpected error occurred invoking '" + target + "' on the server. " + e.what());
+        }
+        return;
+    }
+
+    auto stringArg = [&args](size_t index) {
+        return index < args.size() && args[index].is_string() ? args[index].as_string() : std::string();
+    };
+    auto numberArg = [&args](size_t index) {
+        return index < args.size() && args[index].is_double() ? args[index].as_double() : 0.0;
+    };
+
+    if (target == "Echo") {
+        HubMessage echo;
+        echo.type = MessageType::Invocation;
+        echo.target = "Echo";
+        echo.arguments = args;
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            stats_.messagesSent++;
+        }
+        sendTo(key, encode(echo));
+        complete(key, invocationId, args.empty() ? Value() : args[0], "");
+    } else if (target == "Broadcast" && !stringArg(0).empty()) {
+        broadcast(stringArg(0), std::vector<Value>(args.begin() + 1, args.end()));
+        complete(key, invocationId, Value(), "");
+    } else if (target == "StartBroadcast" && !stringArg(0).empty()) {
+        std::vector<Value> payload(args.size() > 3 ? args.begin() + 3 : args.end(), args.end());
+        startBroadcast(stringArg(0), payload, numberArg(1), static_cast<uint64_t>(numberArg(2)));
+        complete(key, invocationId, Value(), "");
+    } else if (target == "StopBroadcast") {
+        stopBroadcast();
+        complete(key, invocationId, Value(), "");
+    } else if (target == "SetCompletionDelay") {
+        setCompletionDelay(static_cast<int>(numberArg(0)));
+        complete(key, invocationId, Value(), "");
+    } else if (target == "Drop") {
+        complete(key, invocationId, Value(), "");
+        std::string error = stringArg(0);
+        dropConnections(error.empty() ? "Connection dropped by the loopback hub" : error);
+    } else {
+        complete(key, invocationId, Value(), "Failed to invoke '" + target + "' due to an error on the server. HubException: Method does not exist.");
+    }
+}
+
+void LoopbackHub::complete(Peer* key, const std::string& invocationId, const Value& result, const std::string& error) {
+    if (invocationId.empty()) return;   // Sent without expecting a completion
+
+    HubMessage completion;
+    completion.type = MessageType::Completion;
+    completion.invocationId = invocationId;
+    completion.result = result;
+    completion.error = error;
+    std::string frames = encode(completion);
+
+    int delayMs;
+    {
+        std::lock_guard<std::mutex> lock(settingsMutex_);
+        delayMs = completionDelayMs_;
+    }
+    if (delayMs > 0) {
+        post([this, key, frames] { sendTo(key, frames); }, delayMs);
+    } else {
+        sendTo(key, frames);
+    }
+}
+
+void LoopbackHub::sendTo(Peer* key, const std::string& frames) {
+    auto it = sessions_.find(key);
+    if (it == sessions_.end()) return;
+    if (std::shared_ptr<Peer> peer = it->second.peer.lock()) {
+        peer->receive(frames);
+    }
+}
+
+void LoopbackHub::sendToAll(const std::string& frames) {
+    std::vector<std::shared_ptr<Peer>> peers;
+    for (const auto& entry : sessions_) {
+        if (!entry.second.handshaken) continue;
+        if (std::shared_ptr<Peer> peer = entry.second.peer.lock()) {
+            peers.push_back(std::move(peer));
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats_.messagesSent += peers.size();
+    }
+    for (const auto& peer : peers) {
+        peer->receive(frames);
+    }
+}
+
+void LoopbackHub::broadcastTick(uint64_t generation, const std::string& frames, double perSecond, uint64_t remaining,
+                               std::chrono::steady_clock::time_point start, uint64_t sent) {
+    if (generation != broadcastGeneration_.load()) return;
+
+    // Paced from the start time rather than per tick, so timer slack doesn't lower the rate
+    uint64_t due = BroadcastBurst;
+    if (perSecond > 0) {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t target = static_cast<uint64_t>(elapsed * perSecond) + 1;
+        due = target > sent ? std::min<uint64_t>(target - sent, BroadcastBurst) : 0;
+    }
+    if (remaining > 0) due = std::min(due, remaining);
+
+    for (uint64_t i = 0; i < due; ++i) {
+        sendToAll(frames);
+    }
+    sent += due;
+    if (remaining > 0) {
+        remaining -= due;
+        if (remaining == 0) return;
+    }
+
+    auto next = perSecond > 0
+        ? start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(sent / perSecond))
+        : std::chrono::steady_clock::now();
+    postAt([this, generation, frames, perSecond, remaining, start, sent] {
+        broadcastTick(generation, frames, perSecond, remaining, start, sent);
+    }, next);
+}
+
+void LoopbackHub::closeAll(const std::string& error) {
+    HubMessage close;
+    close.type = MessageType::Close;
+    close.error = error;
+    std::string frames = encode(close);
+
+    std::map<Peer*, Session> sessions;
+    sessions.swap(sessions_);
+    connectionCount_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats_.drops += sessions.size();
+    }
+    for (const auto& entry : sessions) {
+        if (std::shared_ptr<Peer> peer = entry.second.peer.lock()) {
+            peer->receive(frames);
+        }
+    }
+}
+
+} // namespace WebS
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <stdexcept>
+#include "Value.h"
+
+namespace WebS {
+
+// Connection failure as a server would report it; the transport maps it to an HTTP status
+class LoopbackError : public std::runtime_error {
+public:
+    LoopbackError(const std::string& message, int statusCode)
+        : std::runtime_error(message), statusCode_(statusCode) {}
+
+    int statusCode() const { return statusCode_; }
+
+private:
+    int statusCode_;
+};
+
+// In-process stand-in for an ASP.NET SignalR hub, for end-to-end benchmarks and reconnect
+// tests without a server. Clients reach it through LoopbackTransport and talk the SignalR
+// JSON hub protocol (handshake, record-separated frames); everything the hub does runs on
+// its own thread, which also plays the network thread delivering client callbacks.
+//
+// Built-in hub methods, so Lua scripts can drive it through SendMessage/SendMessageAsync:
+//   Echo(...)                                   completes with the first argument and
+//                                               invokes Echo(...) back on the caller
+//   Broadcast(method, ...)                      invokes method(...) on every connection
+//   StartBroadcast(method, perSecond, count, ...)  repeats Broadcast; perSecond <= 0 = as fast
+//                                               as possible, count 0 = until StopBroadcast
+//   StopBroadcast()
+//   SetCompletionDelay(ms)                      delays every completion from now on
+//   Drop([error])                               closes every connection with an error
+// Methods added with setMethod() take precedence.
+class LoopbackHub {
+public:
+    // Throwing fails the invocation with the exception's message
+    using Method = std::function<Value(const std::vector<Value>& args)>;
+
+    // Client end of one connection, called on the hub thread
+    class Peer {
+    public:
+        virtual ~Peer() = default;
+        virtual void receive(const std::string& frames) = 0;
+    };
+
+    struct Stats {
+        uint64_t connects = 0;
+        uint64_t rejectedConnects = 0;
+        uint64_t invocations = 0;      // Received from clients
+        uint64_t messagesSent = 0;     // Invocations sent to clients
+        uint64_t drops = 0;            // Connections closed by the hub
+    };
+
+    static constexpr int BroadcastBurst = 64;   // Unthrottled broadcasts yield to other work after this many
+
+    LoopbackHub();
+    ~LoopbackHub();
+
+    LoopbackHub(const LoopbackHub&) = delete;
+    LoopbackHub& operator=(const LoopbackHub&) = delete;
+
+    void setMethod(const std::string& name, Method method);
+    void setConnectDelay(int ms);
+    void setCompletionDelay(int ms);
+    // The next count connection attempts fail with this status, e.g. 503 or 401
+    void failConnects(int count, int httpStatus, const std::string& message = "Service unavailable");
+
+    void broadcast(const std::string& method, const std::vector<Value>& args);
+    void startBroadcast(const std::string& method, const std::vector<Value>& args, double perSecond, uint64_t count = 0);
+    void stopBroadcast();
+    void dropConnections(const std::string& error = "Connection dropped by the loopback hub");
+
+    size_t connectionCount() const;
+    Stats stats() const;
+
+    // Transport side. done gets the connection id, or the error refusing the connection.
+    void connect(std::shared_ptr<Peer> peer, std::function<void(std::exception_ptr, const std::string&)> done);
+    void send(const std::shared_ptr<Peer>& peer, std::string frames);
+    void disconnect(const std::shared_ptr<Peer>& peer, std::function<void()> done);
+
+private:
+    struct Session {
+        std::weak_ptr<Peer> peer;
+        std::string buffer;
+        bool handshaken = false;
+    };
+
+    struct Task {
+        std::chrono::steady_clock::time_point due;
+        uint64_t sequence;
+        std::function<void()> run;
+
+        bool operator>(const Task& other) const {
+            return due != other.due ? due > other.due : sequence > other.sequence;
+        }
+    };
+
+    void post(std::function<void()> run, int delayMs = 0);
+    void postAt(std::function<void()> run, std::chrono::steady_clock::time_point due);
+    void run();
+
+    // Hub thread only
+    void handleFrame(Peer* key, Session& session, const std::string& frame);
+    void invokeMethod(Peer* key, const std::string& invocationId, const std::string& target, const std::vector<Value>& args);
+    void complete(Peer* key, const std::string& invocationId, const Value& result, const std::string& error);
+    void sendTo(Peer* key, const std::string& frames);
+    void sendToAll(const std::string& frames);
+    void broadcastTick(uint64_t generation, const std::string& frames, double perSecond, uint64_t remaining,
+                       std::chrono::steady_clock::time_point start, uint64_t sent);
+    void closeAll(const std::string& error);
+
+    std::map<Peer*, Session> sessions_;
+    uint64_t nextConnectionId_ = 0;
+
+    mutable std::mutex settingsMutex_;
+    std::map<std::string, Method> methods_;
+    int connectDelayMs_ = 0;
+    int completionDelayMs_ = 0;
+    int failConnects_ = 0;
+    int failStatus_ = 0;
+    std::string failMessage_;
+
+    std::atomic<uint64_t> broadcastGeneration_{0};
+    std::atomic<size_t> connectionCount_{0};
+
+    mutable std::mutex statsMutex_;
+    Stats stats_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::priority_queue<Task, std::vector<Task>, std::greater<Task>> tasks_;
+    uint64_t nextSequence_ = 0;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace WebS
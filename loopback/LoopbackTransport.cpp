@@ -0,0 +1,265 @@
+#include "pch.h"
+#include "LoopbackTransport.h"
+#include "HubProtocol.h"
+
+namespace WebS {
+
+using namespace HubProtocol;
+
+namespace {
+
+// Client end of a loopback connection. Frames are encoded on the caller's thread and
+// decoded on the hub thread, which also runs every callback, as SignalR's own threads would.
+class LoopbackConnection : public HubConnection, public LoopbackHub::Peer,
+                           public std::enable_shared_from_this<LoopbackConnection> {
+public:
+    explicit LoopbackConnection(std::weak_ptr<LoopbackHub> hub) : hub_(std::move(hub)) {}
+
+    void on(const std::string& method, const MethodHandler& handler) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handlers_[method] = handler;
+    }
+
+    void setDisconnected(const Callback& callback) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        disconnected_ = callback;
+    }
+
+    void start(Callback callback) override {
+        std::shared_ptr<LoopbackHub> hub = hub_.lock();
+        if (!hub) {
+            callback(std::make_exception_ptr(std::runtime_error("The loopback hub is gone")));
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (state_ != State::Disconnected) {
+                lock.unlock();
+                callback(std::make_exception_ptr(std::runtime_error("The connection can only be started if it is in the disconnected state")));
+                return;
+            }
+            state_ = State::Connecting;
+            startCallback_ = std::move(callback);
+        }
+
+        std::weak_ptr<LoopbackConnection> weakSelf = shared_from_this();
+        hub->connect(shared_from_this(), [weakSelf](std::exception_ptr error, const std::string& connectionId) {
+            std::shared_ptr<LoopbackConnection> self = weakSelf.lock();
+            if (!self) return;
+            if (error) {
+                self->finishStart(error);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(self->mutex_);
+                self->connectionId_ = connectionId;
+            }
+            if (std::shared_ptr<LoopbackHub> hub = self->hub_.lock()) {
+                hub->send(self, handshakeRequest());
+            }
+        });
+    }
+
+    void stop(Callback callback) override {
+        std::shared_ptr<LoopbackHub> hub = hub_.lock();
+        if (!hub || state_.load() == State::Disconnected) {
+            closed(nullptr);
+            callback(nullptr);
+            return;
+        }
+
+        auto self = shared_from_this();
+        hub->disconnect(self, [self, callback] {
+            self->closed(nullptr);
+            callback(nullptr);
+        });
+    }
+
+    void invoke(const std::string& method, const std::vector<Value>& args, InvokeCallback callback) override {
+        HubMessage message;
+        message.type = MessageType::Invocation;
+        message.target = method;
+        message.arguments = args;
+
+        std::shared_ptr<LoopbackHub> hub = hub_.lock();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (state_ != State::Connected || !hub) {
+                lock.unlock();
+                callback(Value(), std::make_exception_ptr(std::runtime_error(
+                    "Cannot send data when the connection is not in the connected state.")));
+                return;
+            }
+            message.invocationId = std::to_string(++nextInvocationId_);
+            pending_[message.invocationId] = std::move(callback);
+        }
+        hub->send(shared_from_this(), encode(message));
+    }
+
+    std::string connectionId() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connectionId_;
+    }
+
+    void receive(const std::string& frames) override {
+        buffer_ += frames;
+        std::vector<std::string> complete;
+        splitFrames(buffer_, complete);
+
+        for (const auto& frame : complete) {
+            if (state_.load() == State::Connecting) {
+                std::string error;
+                if (parseHandshakeResponse(frame, error)) {
+                    finishStart(nullptr);
+                } else {
+                    finishStart(std::make_exception_ptr(std::runtime_error("Received an error during handshake: " + error)));
+                }
+                continue;
+            }
+
+            HubMessage message;
+            if (!decode(frame, message)) continue;
+            switch (message.type) {
+                case MessageType::Invocation:
+                    dispatch(message);
+                    break;
+                case MessageType::Completion:
+                    completeInvocation(message);
+                    break;
+                case MessageType::Close:
+                    closed(message.error.empty() ? nullptr : std::make_exception_ptr(std::runtime_error(message.error)));
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+private:
+    enum class State { Disconnected, Connecting, Connected };
+
+    void finishStart(std::exception_ptr error) {
+        Callback callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            state_ = error ? State::Disconnected : State::Connected;
+            callback = std::move(startCallback_);
+        }
+        if (callback) callback(error);
+    }
+
+    void dispatch(const HubMessage& message) {
+        MethodHandler handler;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = handlers_.find(message.target);
+            if (it == handlers_.end()) return;
+            handler = it->second;
+        }
+        try {
+            handler(message.arguments);
+        } catch (...) {
+            // SignalR logs and swallows handler exceptions
+        }
+    }
+
+    void completeInvocation(const HubMessage& message) {
+        InvokeCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = pending_.find(message.invocationId);
+            if (it == pending_.end()) return;
+            callback = std::move(it->second);
+            pending_.erase(it);
+        }
+        if (message.error.empty()) {
+            callback(message.result, nullptr);
+        } else {
+            callback(Value(), std::make_exception_ptr(std::runtime_error(message.error)));
+        }
+    }
+
+    // Fails whatever still waits on the connection. One that is still starting fails its
+    // start callback instead of reporting a disconnect.
+    void closed(std::exception_ptr error) {
+        Callback disconnected;
+        Callback start;
+        std::map<std::string, InvokeCallback> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (state_ != State::Disconnected) {
+                disconnected = disconnected_;
+            }
+            state_ = State::Disconnected;
+            start = std::move(startCallback_);
+            pending.swap(pending_);
+        }
+        buffer_.clear();
+
+        for (auto& entry : pending) {
+            entry.second(Value(), std::make_exception_ptr(std::runtime_error(
+                "Connection was stopped before invocation result was received.")));
+        }
+        if (start) {
+            start(error ? error : std::make_exception_ptr(std::runtime_error("Connection was stopped before it was established")));
+        } else if (disconnected) {
+            disconnected(error);
+        }
+    }
+
+    std::weak_ptr<LoopbackHub> hub_;
+    mutable std::mutex mutex_;
+    std::atomic<State> state_{State::Disconnected};
+    std::string connectionId_;
+    std::map<std::string, MethodHandler> handlers_;
+    Callback disconnected_;
+    Callback startCallback_;
+    std::map<std::string, InvokeCallback> pending_;
+    uint64_t nextInvocationId_ = 0;
+    std::string buffer_;   // Hub thread only
+};
+
+class LoopbackProbe : public EndpointProbe {
+public:
+    explicit LoopbackProbe(size_t count) : results_(count) {
+        for (auto& result : results_) result.status = 200;
+    }
+
+    std::vector<ProbeResult> wait() override { return results_; }
+    void cancel() override { cancelled_ = true; }
+    bool cancelled() const override { return cancelled_.load(); }
+
+private:
+    std::vector<ProbeResult> results_;
+    std::atomic<bool> cancelled_{false};
+};
+
+} // namespace
+
+LoopbackTransport::LoopbackTransport(std::shared_ptr<LoopbackHub> hub) : hub_(std::move(hub)) {}
+
+void LoopbackTransport::install(std::shared_ptr<LoopbackHub> hub) {
+    Transport::setFactory([hub] {
+        return std::unique_ptr<Transport>(new LoopbackTransport(hub));
+    });
+}
+
+std::shared_ptr<HubConnection> LoopbackTransport::createConnection(const std::string&, const ConnectOptions&, LogLevel) {
+    return std::make_shared<LoopbackConnection>(hub_);
+}
+
+std::shared_ptr<EndpointProbe> LoopbackTransport::probe(const std::vector<std::string>& urls, const ConnectOptions&, int) {
+    return std::make_shared<LoopbackProbe>(urls.size());
+}
+
+int LoopbackTransport::httpStatus(std::exception_ptr error) const {
+    try {
+        std::rethrow_exception(error);
+    } catch (const LoopbackError& e) {
+        return e.statusCode();
+    } catch (...) {
+        return 0;
+    }
+}
+
+} // namespace WebS
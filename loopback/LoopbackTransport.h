@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include "Transport.h"
+#include "LoopbackHub.h"
+
+namespace WebS {
+
+// Transport whose connections all lead to one in-process LoopbackHub, whatever the url.
+class LoopbackTransport : public Transport {
+public:
+    explicit LoopbackTransport(std::shared_ptr<LoopbackHub> hub);
+
+    // Makes every client created from now on connect to hub
+    static void install(std::shared_ptr<LoopbackHub> hub);
+
+    std::shared_ptr<HubConnection> createConnection(const std::string& url, const ConnectOptions& options, LogLevel logLevel) override;
+    std::shared_ptr<EndpointProbe> probe(const std::vector<std::string>& urls, const ConnectOptions& options, int timeoutMs) override;
+    int httpStatus(std::exception_ptr error) const override;
+
+private:
+    std::shared_ptr<LoopbackHub> hub_;
+};
+
+} // namespace WebS
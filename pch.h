@@ -1,7 +1,9 @@
 #ifndef PCH_H
 #define PCH_H
 
+#ifdef _WIN32
 #include "framework.h"
+#endif
 
 #include <iostream>
 #include <fstream>
@@ -21,10 +23,12 @@
 #include <cmath>
 #include <algorithm>
 
+#ifdef WEBS_WITH_SIGNALR
 #include "signalrclient/hub_connection.h"
 #include "signalrclient/hub_connection_builder.h"
 #include "signalrclient/signalr_client_config.h"
 #include "signalrclient/web_exception.h"
 #include "signalrclient/signalr_value.h"
+#endif
 
 #endif
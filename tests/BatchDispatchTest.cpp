@@ -0,0 +1,123 @@
+// OnBatch delivery contract, run against the embedded Lua 5.1: each handler gets its own batch
+// table, the tables are only valid during the call (the next frame overwrites them in place),
+// and a handler removed by an earlier one in the same frame is not called.
+
+#include "EventManager.h"
+#include "Logger.h"
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+}
+
+using namespace WebS;
+
+namespace {
+
+class BatchDispatchTest : public ::testing::Test {
+protected:
+    lua_State* L = luaL_newstate();
+    EventManager events;
+
+    void SetUp() override {
+        Logger::instance().setMinLevel(LogLevel::Critical);
+        luaL_openlibs(L);
+        events.setLegacyCallbacks(false);
+    }
+
+    void TearDown() override {
+        events.clear(L);
+        lua_close(L);
+    }
+
+    // Registers the chunk's returned function as a batch handler
+    int onBatch(const char* chunk) {
+        EXPECT_EQ(luaL_dostring(L, chunk), 0);
+        int ref = events.onBatch(L, "OnPosition", lua_gettop(L));
+        lua_pop(L, 1);
+        return ref;
+    }
+
+    void dispatch(double x) {
+        std::vector<ServerMessage> messages(1);
+        messages[0].method = "OnPosition";
+        messages[0].args = { Value(x) };
+        events.dispatchBatch(L, "OnPosition", messages);
+    }
+
+    double global(const char* name) {
+        lua_getglobal(L, name);
+        double value = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+        return value;
+    }
+
+    bool truthy(const char* expression) {
+        std::string chunk = std::string("return ") + expression;
+        EXPECT_EQ(luaL_dostring(L, chunk.c_str()), 0);
+        bool value = lua_toboolean(L, -1) != 0;
+        lua_pop(L, 1);
+        return value;
+    }
+};
+
+struct OffRequest {
+    EventManager* events;
+    int ref;
+};
+
+// offOther(): removes the handler in the upvalue, then takes registry refs so the freed slots
+// hold something else, as they would after any other luaL_ref
+int offOther(lua_State* L) {
+    OffRequest* request = static_cast<OffRequest*>(lua_touserdata(L, lua_upvalueindex(1)));
+    request->events->off(L, "OnPosition", request->ref);
+    lua_pushstring(L, "not a table");
+    luaL_ref(L, LUA_REGISTRYINDEX);
+    luaL_dostring(L, "return function() staleCalled = true end");
+    luaL_ref(L, LUA_REGISTRYINDEX);
+    return 0;
+}
+
+} // namespace
+
+TEST_F(BatchDispatchTest, HandlersGetTheirOwnTables) {
+    onBatch("return function(batch, count) first = batch end");
+    onBatch("return function(batch, count) second = batch end");
+    dispatch(1);
+
+    EXPECT_TRUE(truthy("first ~= second"));
+    EXPECT_TRUE(truthy("first[1] ~= second[1]"));
+    EXPECT_TRUE(truthy("first[1][1] == 1 and second[1][1] == 1"));
+}
+
+TEST_F(BatchDispatchTest, TablesAreOverwrittenByTheNextFrame) {
+    onBatch("return function(batch, count) kept = kept or batch; keptArgs = keptArgs or batch[1]; last = batch[1][1] end");
+    dispatch(1);
+    EXPECT_EQ(global("last"), 1);
+
+    // A handler that changed its table gets the next frame's data written over it
+    ASSERT_EQ(luaL_dostring(L, "keptArgs[1] = 'changed'; keptArgs[2] = 'extra'"), 0);
+    dispatch(2);
+    EXPECT_EQ(global("last"), 2);
+    EXPECT_TRUE(truthy("kept[1] == keptArgs"));
+    EXPECT_TRUE(truthy("keptArgs[1] == 2 and keptArgs[2] == nil"));
+}
+
+TEST_F(BatchDispatchTest, HandlerRemovedByAnEarlierOneIsNotCalled) {
+    ASSERT_EQ(luaL_dostring(L, "secondCalls = 0"), 0);
+    OffRequest request{ &events, LUA_NOREF };
+    lua_pushlightuserdata(L, &request);
+    lua_pushcclosure(L, offOther, 1);
+    lua_setglobal(L, "offOther");
+
+    onBatch("return function(batch, count) offOther() end");
+    request.ref = onBatch("return function(batch, count) secondCalls = secondCalls + 1 end");
+
+    dispatch(1);
+    EXPECT_EQ(global("secondCalls"), 0);
+    EXPECT_FALSE(truthy("staleCalled"));
+    EXPECT_EQ(events.batchCallbackCount("OnPosition"), 1u);
+}
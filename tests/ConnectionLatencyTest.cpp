@@ -0,0 +1,85 @@
+// Connection state transitions against the loopback hub, with latency budgets: each
+// transition is driven by stateCv_, so none of them should wait on a poll interval or a
+// backoff timer. Budgets are loose enough for a loaded CI machine.
+
+#include "LoopbackSession.h"
+
+#include <gtest/gtest.h>
+
+using namespace WebS;
+using namespace WebS::Testing;
+
+namespace {
+
+constexpr double ConnectBudgetMs = 250;
+constexpr double DropBudgetMs = 100;
+constexpr double DisconnectBudgetMs = 100;
+constexpr int LongBackoffMs = 30000;
+
+class ConnectionLatencyTest : public ::testing::Test {
+protected:
+    std::shared_ptr<LoopbackHub> hub = installHub();
+    WebSClient& client = WebSClient::get(uniqueClientName("latency"));
+
+    void TearDown() override {
+        disconnectClient(client);
+    }
+
+    void connectAndWait() {
+        client.connect(HubUrl);
+        ASSERT_TRUE(waitForStatus(client, ConnectionStatus::CONNECTED));
+    }
+};
+
+} // namespace
+
+TEST_F(ConnectionLatencyTest, ConnectReachesConnected) {
+    auto started = Clock::now();
+    ASSERT_TRUE(client.connect(HubUrl));
+    ASSERT_TRUE(waitForStatus(client, ConnectionStatus::CONNECTED));
+    EXPECT_LT(elapsedMs(started), ConnectBudgetMs);
+    EXPECT_EQ(hub->stats().connects, 1u);
+    EXPECT_FALSE(client.connectionId().empty());
+}
+
+TEST_F(ConnectionLatencyTest, HubDropReachesReconnecting) {
+    client.setReconnectConfig(fixedBackoff(LongBackoffMs));
+    connectAndWait();
+
+    auto dropped = Clock::now();
+    hub->dropConnections();
+    ASSERT_TRUE(waitForStatus(client, ConnectionStatus::RECONNECTING));
+    EXPECT_LT(elapsedMs(dropped), DropBudgetMs);
+    EXPECT_EQ(client.reconnectAttempts(), 1);
+    // Still inside the backoff, so no reconnect has been attempted yet
+    EXPECT_EQ(hub->stats().connects, 1u);
+}
+
+TEST_F(ConnectionLatencyTest, DisconnectDuringBackoffIsImmediate) {
+    client.setReconnectConfig(fixedBackoff(LongBackoffMs));
+    connectAndWait();
+    hub->dropConnections();
+    ASSERT_TRUE(waitForStatus(client, ConnectionStatus::RECONNECTING));
+
+    auto requested = Clock::now();
+    client.disconnect();
+    ASSERT_TRUE(waitForStatus(client, ConnectionStatus::DISCONNECTED));
+    EXPECT_LT(elapsedMs(requested), DisconnectBudgetMs);
+    EXPECT_EQ(hub->stats().connects, 1u);
+}
+
+TEST_F(ConnectionLatencyTest, ReconnectsAfterBackoff) {
+    constexpr int BackoffMs = 50;
+    client.setReconnectConfig(fixedBackoff(BackoffMs));
+    connectAndWait();
+
+    auto dropped = Clock::now();
+    hub->dropConnections();
+    ASSERT_TRUE(waitForStatus(client, ConnectionStatus::RECONNECTING));
+    ASSERT_TRUE(waitForStatus(client, ConnectionStatus::CONNECTED));
+    double reconnectMs = elapsedMs(dropped);
+    EXPECT_GE(reconnectMs, BackoffMs);
+    EXPECT_LT(reconnectMs, BackoffMs + ConnectBudgetMs);
+    EXPECT_EQ(hub->stats().connects, 2u);
+    EXPECT_EQ(client.reconnectAttempts(), 0);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// Test helpers for driving WebSClient against an in-process LoopbackHub, with no Lua state
+// attached. Clients keep their transport for life and are never destroyed, so every test
+// gets a fresh hub and clients under names no other test uses.
+
+#include "LoopbackHub.h"
+#include "LoopbackTransport.h"
+#include "WebSClient.h"
+#include "Logger.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace WebS {
+namespace Testing {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int WaitTimeoutMs = 5000;
+constexpr const char* HubUrl = "http://loopback/hub";
+
+inline double elapsedMs(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+// Polls until the client reports status; false after timeoutMs
+inline bool waitForStatus(const WebSClient& client, ConnectionStatus status, int timeoutMs = WaitTimeoutMs) {
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (client.status() != status) {
+        if (Clock::now() > deadline) return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+// A hub installed as the transport for clients created from now on
+inline std::shared_ptr<LoopbackHub> installHub() {
+    Logger::instance().setMinLevel(LogLevel::Critical);
+    auto hub = std::make_shared<LoopbackHub>();
+    LoopbackTransport::install(hub);
+    return hub;
+}
+
+// A client name unique to this process
+inline std::string uniqueClientName(const std::string& prefix) {
+    static int next = 0;
+    return prefix + "-" + std::to_string(++next);
+}
+
+// Reconnect with a fixed backoff, long enough to observe RECONNECTING
+inline ReconnectConfig fixedBackoff(int delayMs) {
+    ReconnectConfig config;
+    config.enabled = true;
+    config.maxAttempts = 0;
+    config.initialDelayMs = delayMs;
+    config.maxDelayMs = delayMs;
+    config.jitter = JitterMode::NONE;
+    return config;
+}
+
+// Leaves the client disconnected, so nothing keeps talking to the test's hub
+inline void disconnectClient(WebSClient& client) {
+    client.disconnect();
+    waitForStatus(client, ConnectionStatus::DISCONNECTED);
+}
+
+} // namespace Testing
+} // namespace WebS
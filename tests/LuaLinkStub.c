@@ -0,0 +1,53 @@
+/* Stand-ins for the Lua 5.1 C API when no Lua sources are configured. webs_core references
+ * these from the Lua bindings, which the loopback tests never reach; any call aborts. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void unreachable(const char* name) {
+    fprintf(stderr, "webs_tests: %s called without an embedded Lua\n", name);
+    abort();
+}
+
+#define LUA_STUB(name) void name(void) { unreachable(#name); }
+
+LUA_STUB(luaL_checklstring)
+LUA_STUB(luaL_error)
+LUA_STUB(luaL_openlib)
+LUA_STUB(luaL_optinteger)
+LUA_STUB(luaL_optlstring)
+LUA_STUB(luaL_optnumber)
+LUA_STUB(luaL_ref)
+LUA_STUB(luaL_unref)
+LUA_STUB(lua_checkstack)
+LUA_STUB(lua_createtable)
+LUA_STUB(lua_getfield)
+LUA_STUB(lua_getinfo)
+LUA_STUB(lua_gettop)
+LUA_STUB(lua_isnumber)
+LUA_STUB(lua_isstring)
+LUA_STUB(lua_newuserdata)
+LUA_STUB(lua_objlen)
+LUA_STUB(lua_pcall)
+LUA_STUB(lua_pushboolean)
+LUA_STUB(lua_pushcclosure)
+LUA_STUB(lua_pushinteger)
+LUA_STUB(lua_pushlightuserdata)
+LUA_STUB(lua_pushlstring)
+LUA_STUB(lua_pushnil)
+LUA_STUB(lua_pushnumber)
+LUA_STUB(lua_pushstring)
+LUA_STUB(lua_pushvalue)
+LUA_STUB(lua_rawgeti)
+LUA_STUB(lua_rawseti)
+LUA_STUB(lua_remove)
+LUA_STUB(lua_setfield)
+LUA_STUB(lua_setmetatable)
+LUA_STUB(lua_settable)
+LUA_STUB(lua_settop)
+LUA_STUB(lua_toboolean)
+LUA_STUB(lua_tointeger)
+LUA_STUB(lua_tolstring)
+LUA_STUB(lua_tonumber)
+LUA_STUB(lua_touserdata)
+LUA_STUB(lua_type)
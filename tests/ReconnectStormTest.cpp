@@ -0,0 +1,204 @@
+// Many clients on one hub losing their connections at once, as when a server restarts: the
+// reconnect policy has to spread them out, stop on refusals that will not change, honor the
+// server's Retry-After and give way to Disconnect() at any point of the backoff.
+
+#include "LoopbackSession.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace WebS;
+using namespace WebS::Testing;
+
+namespace {
+
+constexpr int ClientCount = 24;
+constexpr double DisconnectBudgetMs = 100;
+
+class ReconnectStormTest : public ::testing::Test {
+protected:
+    std::shared_ptr<LoopbackHub> hub = installHub();
+    std::vector<WebSClient*> clients;
+
+    void SetUp() override {
+        for (int i = 0; i < ClientCount; ++i) {
+            clients.push_back(&WebSClient::get(uniqueClientName("storm")));
+        }
+    }
+
+    void TearDown() override {
+        for (WebSClient* client : clients) {
+            disconnectClient(*client);
+        }
+    }
+
+    void connectAll(const ReconnectConfig& config) {
+        for (WebSClient* client : clients) {
+            client->setReconnectConfig(config);
+            client->connect(HubUrl);
+        }
+        for (WebSClient* client : clients) {
+            ASSERT_TRUE(waitForStatus(*client, ConnectionStatus::CONNECTED));
+        }
+    }
+
+    bool waitForAll(ConnectionStatus status, int timeoutMs = WaitTimeoutMs) {
+        for (WebSClient* client : clients) {
+            if (!waitForStatus(*client, status, timeoutMs)) return false;
+        }
+        return true;
+    }
+
+    bool waitForRejected(uint64_t count) {
+        auto deadline = Clock::now() + std::chrono::milliseconds(WaitTimeoutMs);
+        while (hub->stats().rejectedConnects < count) {
+            if (Clock::now() > deadline) return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // Drops every connection and returns, per client, the ms until it is connected again
+    // under a new connection id; empty if not all of them made it within timeoutMs
+    std::vector<double> dropAndTimeReconnects(int timeoutMs) {
+        std::vector<std::string> previousIds;
+        for (WebSClient* client : clients) {
+            previousIds.push_back(client->connectionId());
+        }
+
+        std::vector<double> reconnectMs(clients.size(), -1);
+        size_t remaining = clients.size();
+        auto dropped = Clock::now();
+        hub->dropConnections();
+        while (remaining > 0) {
+            if (elapsedMs(dropped) > timeoutMs) return {};
+            for (size_t i = 0; i < clients.size(); ++i) {
+                if (reconnectMs[i] >= 0) continue;
+                std::string id = clients[i]->connectionId();
+                if (!id.empty() && id != previousIds[i]) {
+                    reconnectMs[i] = elapsedMs(dropped);
+                    --remaining;
+                }
+            }
+            std::this_thread::yield();
+        }
+        std::sort(reconnectMs.begin(), reconnectMs.end());
+        return reconnectMs;
+    }
+};
+
+ReconnectConfig jittered(JitterMode jitter, int initialDelayMs) {
+    ReconnectConfig config;
+    config.enabled = true;
+    config.maxAttempts = 0;
+    config.initialDelayMs = initialDelayMs;
+    config.maxDelayMs = 30000;
+    config.jitter = jitter;
+    return config;
+}
+
+// Most reconnects that landed within any windowMs of each other; times are sorted
+size_t largestBurst(const std::vector<double>& times, double windowMs) {
+    size_t largest = 0;
+    size_t first = 0;
+    for (size_t last = 0; last < times.size(); ++last) {
+        while (times[last] - times[first] > windowMs) {
+            ++first;
+        }
+        largest = std::max(largest, last - first + 1);
+    }
+    return largest;
+}
+
+} // namespace
+
+// Control for the jitter tests: without jitter the whole storm comes back in one burst
+TEST_F(ReconnectStormTest, WithoutJitterReconnectsTogether) {
+    constexpr int DelayMs = 200;
+    connectAll(jittered(JitterMode::NONE, DelayMs));
+
+    std::vector<double> reconnectMs = dropAndTimeReconnects(WaitTimeoutMs);
+    ASSERT_EQ(reconnectMs.size(), clients.size());
+    EXPECT_GE(reconnectMs.front(), DelayMs);
+    EXPECT_GT(largestBurst(reconnectMs, 50), clients.size() / 2);
+}
+
+// Full jitter draws each delay from [0, initialDelayMs]
+TEST_F(ReconnectStormTest, FullJitterSpreadsReconnects) {
+    constexpr int DelayMs = 400;
+    connectAll(jittered(JitterMode::FULL, DelayMs));
+
+    std::vector<double> reconnectMs = dropAndTimeReconnects(WaitTimeoutMs);
+    ASSERT_EQ(reconnectMs.size(), clients.size());
+    EXPECT_GT(reconnectMs.back() - reconnectMs.front(), DelayMs / 3);
+    EXPECT_LE(largestBurst(reconnectMs, 25), clients.size() / 3);
+}
+
+// Decorrelated jitter draws the first delay from [initialDelayMs, 3 * initialDelayMs]
+TEST_F(ReconnectStormTest, DecorrelatedJitterSpreadsReconnects) {
+    constexpr int DelayMs = 200;
+    connectAll(jittered(JitterMode::DECORRELATED, DelayMs));
+
+    std::vector<double> reconnectMs = dropAndTimeReconnects(WaitTimeoutMs);
+    ASSERT_EQ(reconnectMs.size(), clients.size());
+    EXPECT_GE(reconnectMs.front(), DelayMs);
+    EXPECT_GT(reconnectMs.back() - reconnectMs.front(), DelayMs / 2);
+    EXPECT_LE(largestBurst(reconnectMs, 25), clients.size() / 3);
+}
+
+// A rejected token fails the same way every time: one attempt per client, then disconnected
+TEST_F(ReconnectStormTest, AuthFailuresAreNotRetried) {
+    constexpr int BackoffMs = 10;
+    for (int status : { 401, 403 }) {
+        SCOPED_TRACE("HTTP " + std::to_string(status));
+        connectAll(fixedBackoff(BackoffMs));
+        uint64_t rejected = hub->stats().rejectedConnects;
+
+        hub->failConnects(1000, status, "Unauthorized");
+        hub->dropConnections();
+        ASSERT_TRUE(waitForRejected(rejected + clients.size()));
+        ASSERT_TRUE(waitForAll(ConnectionStatus::DISCONNECTED));
+
+        // Ten backoff periods later nobody has tried again
+        std::this_thread::sleep_for(std::chrono::milliseconds(10 * BackoffMs));
+        EXPECT_EQ(hub->stats().rejectedConnects, rejected + clients.size());
+        for (WebSClient* client : clients) {
+            EXPECT_EQ(client->status(), ConnectionStatus::DISCONNECTED);
+        }
+        hub->failConnects(0, 0);
+    }
+}
+
+// 503 with a Retry-After hint: the hint replaces the much shorter backoff
+TEST_F(ReconnectStormTest, RetryAfterIsHonored) {
+    constexpr int BackoffMs = 10;
+    constexpr int RetryAfterMs = 1000;
+    connectAll(fixedBackoff(BackoffMs));
+
+    hub->failConnects(ClientCount, 503, "Service unavailable, Retry-After: 1");
+    std::vector<double> reconnectMs = dropAndTimeReconnects(WaitTimeoutMs);
+    ASSERT_EQ(reconnectMs.size(), clients.size());
+    EXPECT_EQ(hub->stats().rejectedConnects, static_cast<uint64_t>(ClientCount));
+    // Refused after the first backoff, then back only after the hinted delay
+    EXPECT_GE(reconnectMs.front(), BackoffMs + RetryAfterMs);
+    EXPECT_LT(reconnectMs.back(), BackoffMs + RetryAfterMs + 500);
+}
+
+// Disconnect() while the whole storm sits in its backoff ends every client right away
+TEST_F(ReconnectStormTest, DisconnectCancelsPendingBackoff) {
+    connectAll(fixedBackoff(30000));
+    uint64_t connects = hub->stats().connects;
+
+    hub->dropConnections();
+    ASSERT_TRUE(waitForAll(ConnectionStatus::RECONNECTING));
+
+    auto requested = Clock::now();
+    for (WebSClient* client : clients) {
+        client->disconnect();
+    }
+    ASSERT_TRUE(waitForAll(ConnectionStatus::DISCONNECTED));
+    EXPECT_LT(elapsedMs(requested), DisconnectBudgetMs);
+    EXPECT_EQ(hub->stats().connects, connects);
+}
@@ -0,0 +1,48 @@
+// Per-thread trace rings are allocated by a thread's first span, not by naming the thread,
+// so every client's connection thread doesn't pay for a ring while tracing is off.
+
+#include "Tracer.h"
+#include "Logger.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+using namespace WebS;
+
+namespace {
+
+std::string dumpTrace() {
+    const std::string path = "webs_tracer_test.json";
+    Tracer::instance().dump(path);
+    std::ifstream in(path);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::remove(path.c_str());
+    return text;
+}
+
+} // namespace
+
+TEST(TracerTest, NamingAThreadAllocatesNoRing) {
+    Logger::instance().setMinLevel(LogLevel::Critical);
+    std::thread([] { Tracer::instance().setThreadName("named-but-idle"); }).join();
+    EXPECT_EQ(dumpTrace().find("named-but-idle"), std::string::npos);
+}
+
+TEST(TracerTest, FirstSpanKeepsTheEarlierName) {
+    Logger::instance().setMinLevel(LogLevel::Critical);
+    Tracer::instance().setEnabled(true);
+    std::thread([] {
+        Tracer::instance().setThreadName("named-then-traced");
+        TraceSpan span("test.span", "test");
+    }).join();
+    Tracer::instance().setEnabled(false);
+
+    std::string trace = dumpTrace();
+    EXPECT_NE(trace.find("\"named-then-traced\""), std::string::npos);
+    EXPECT_NE(trace.find("\"test.span\""), std::string::npos);
+}
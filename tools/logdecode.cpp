@@ -0,0 +1,164 @@
+// Decodes a binary WebS log (websocketLogging.bin) into the websocketLogging.txt text format.
+//
+//   logdecode websocketLogging.bin [output.txt]
+//
+// Build: cl /EHsc /std:c++17 logdecode.cpp   or   g++ -std=c++17 -O2 -o logdecode logdecode.cpp
+
+#include "../LogFormats.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace WebS;
+
+namespace {
+
+const char* levelName(uint8_t level) {
+    static const char* const names[] = { "none", "critical", "error", "warning", "info", "debug", "verbose" };
+    return level < sizeof(names) / sizeof(names[0]) ? names[level] : "unknown";
+}
+
+class Reader {
+public:
+    explicit Reader(std::istream& in) : in_(in) {}
+
+    template<typename T>
+    bool read(T& value) {
+        char bytes[sizeof(T)];
+        if (!in_.read(bytes, sizeof(T))) return false;
+        std::memcpy(&value, bytes, sizeof(T));
+        return true;
+    }
+
+    bool readString(std::string& out) {
+        uint32_t length = 0;
+        if (!read(length) || length > BinaryLog::MaxStringLength) return false;
+        out.resize(length);
+        return length == 0 || static_cast<bool>(in_.read(&out[0], length));
+    }
+
+    bool readBytes(char* out, size_t size) {
+        return static_cast<bool>(in_.read(out, static_cast<std::streamsize>(size)));
+    }
+
+private:
+    std::istream& in_;
+};
+
+std::string formatTimestamp(int64_t unixMicros, int32_t offsetMinutes) {
+    int64_t localMicros = unixMicros + static_cast<int64_t>(offsetMinutes) * 60 * 1000000;
+    std::time_t seconds = static_cast<std::time_t>(localMicros / 1000000);
+    int millis = static_cast<int>((localMicros / 1000) % 1000);
+
+    char date[32] = "?";
+    if (const std::tm* tm = std::gmtime(&seconds)) {
+        std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", tm);
+    }
+    char out[48];
+    std::snprintf(out, sizeof(out), "%s.%03d", date, millis);
+    return out;
+}
+
+bool decodeRecord(Reader& reader, int32_t offsetMinutes, std::string& line) {
+    int64_t micros = 0;
+    uint8_t level = 0;
+    uint8_t source = 0;
+    uint16_t formatId = 0;
+    uint8_t argCount = 0;
+    if (!reader.read(micros) || !reader.read(level) || !reader.read(source) ||
+        !reader.read(formatId) || !reader.read(argCount)) {
+        return false;
+    }
+
+    std::vector<LogArg> args(argCount);
+    for (LogArg& arg : args) {
+        uint8_t type = 0;
+        if (!reader.read(type)) return false;
+        arg.type = static_cast<LogArg::Type>(type);
+        switch (arg.type) {
+            case LogArg::Type::Int: if (!reader.read(arg.integer)) return false; break;
+            case LogArg::Type::Double: if (!reader.read(arg.number)) return false; break;
+            case LogArg::Type::String: if (!reader.readString(arg.text)) return false; break;
+            default: return false;
+        }
+    }
+
+    char prefix[64];
+    std::snprintf(prefix, sizeof(prefix), "[%s] [%-9s] ", formatTimestamp(micros, offsetMinutes).c_str(),
+                  source == 1 ? "signalr" : levelName(level));
+    line = prefix;
+    FormatLogMessage(static_cast<LogFormat>(formatId), args.data(), args.size(), line);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: logdecode <websocketLogging.bin> [output.txt]" << std::endl;
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc > 2) {
+        file.open(argv[2], std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Cannot create " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = argc > 2 ? static_cast<std::ostream&>(file) : std::cout;
+
+    Reader reader(in);
+    int32_t offsetMinutes = 0;
+    bool sawHeader = false;
+    size_t records = 0;
+    std::string line;
+
+    char kind;
+    while (reader.read(kind)) {
+        if (kind == '\0') {
+            // Preallocated space of a file the client never closed (e.g. the game crashed)
+            break;
+        }
+        if (kind == BinaryLog::HeaderKind) {
+            char magic[sizeof(BinaryLog::Magic)];
+            uint16_t version = 0;
+            if (!reader.readBytes(magic, sizeof(magic)) || std::memcmp(magic, BinaryLog::Magic, sizeof(magic)) != 0 ||
+                !reader.read(version) || !reader.read(offsetMinutes)) {
+                std::cerr << "Corrupt header after " << records << " records" << std::endl;
+                return 1;
+            }
+            if (version > BinaryLog::Version) {
+                std::cerr << "Unsupported log version " << version << std::endl;
+                return 1;
+            }
+            sawHeader = true;
+        } else if (kind == BinaryLog::RecordKind && sawHeader) {
+            if (!decodeRecord(reader, offsetMinutes, line)) {
+                // A session killed mid-write leaves a truncated last record
+                std::cerr << "Truncated record after " << records << " records" << std::endl;
+                break;
+            }
+            out << line << '\n';
+            records++;
+        } else {
+            std::cerr << "Not a WebS binary log, or corrupt after " << records << " records" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cerr << records << " records decoded" << std::endl;
+    return 0;
+}
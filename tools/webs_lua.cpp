@@ -0,0 +1,60 @@
+// Runs a Lua script in a standalone Lua 5.1 with WebS preloaded, so scripts can be exercised
+// and profiled (perf, valgrind, ...) outside the game.
+//
+//   webs_lua [--loopback] script.lua [args...]   (the arguments are in the global table `arg`)
+//
+// --loopback connects every client to an in-process LoopbackHub instead of the network, whatever
+// the URL; scripts drive it through its built-in hub methods (see LoopbackHub.h).
+// Events only fire from WebS.ProcessEvents(); a script drives its own loop.
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "LoopbackHub.h"
+#include "LoopbackTransport.h"
+
+extern "C" {
+#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+
+int luaopen_WebS(lua_State* L);
+}
+
+int main(int argc, char** argv) {
+    const char* program = argv[0];
+    std::shared_ptr<WebS::LoopbackHub> hub;
+    if (argc > 1 && std::strcmp(argv[1], "--loopback") == 0) {
+        hub = std::make_shared<WebS::LoopbackHub>();
+        WebS::LoopbackTransport::install(hub);
+        --argc;
+        ++argv;
+    }
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s [--loopback] script.lua [args...]\n", program);
+        return 2;
+    }
+
+    lua_State* L = luaL_newstate();
+    luaL_openlibs(L);
+
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "preload");
+    lua_pushcfunction(L, luaopen_WebS);
+    lua_setfield(L, -2, "WebS");
+    lua_pop(L, 2);
+
+    lua_newtable(L);
+    for (int i = 1; i < argc; ++i) {
+        lua_pushstring(L, argv[i]);
+        lua_rawseti(L, -2, i - 1);
+    }
+    lua_setglobal(L, "arg");
+
+    int status = luaL_dofile(L, argv[1]);
+    if (status != 0) {
+        std::fprintf(stderr, "%s\n", lua_tostring(L, -1));
+    }
+    lua_close(L);
+    return status == 0 ? 0 : 1;
+}